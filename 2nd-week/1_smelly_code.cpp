@@ -75,8 +75,10 @@ void test(string_view out_filename, size_t count) {
   }
 }
 
+#ifndef BENCHMARK
 int main() {
   test("resource.log"sv, 1000);
 
   return 0;
 }
+#endif
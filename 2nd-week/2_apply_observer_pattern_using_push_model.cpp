@@ -1,11 +1,34 @@
-#include <unordered_map>
-#include <unordered_set>
 #include <mutex>
-#include <sstream>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "message.hpp"
+#include "resource_manager.hpp"
+#include "sharded_resource_manager.hpp"
+#include "worker_pool.hpp"
+#include "observer_list.hpp"
 #include "file_handler.hpp"
+#include "mpsc_ring.hpp"
+#include "message_arena.hpp"
+#include "binary_log.hpp"
+#include "segmented_log.hpp"
+#include "sampling_scheduler.hpp"
+#include "streaming_stats.hpp"
+#include "shm_ring.hpp"
+#include "compressed_log.hpp"
+#include "service_stats.hpp"
+#include "time_series.hpp"
+#include "rule_engine.hpp"
+#include "change_filter.hpp"
 
 using namespace std;
 
@@ -13,6 +36,11 @@ struct ILogger {
   virtual ~ILogger() = default;
 
   virtual void write(string_view msg) = 0;
+
+  // Loggers keeping structured data override this; the rest get the text.
+  virtual void write_sample(const Sample& sample, string_view msg) {
+    write(msg);
+  }
 };
 
 class ConsoleLogger : public ILogger {
@@ -39,6 +67,97 @@ public:
   }
 };
 
+class BatchFileLogger : public ILogger {
+  BatchFileHandler file_handler;
+
+public:
+  BatchFileLogger(string_view out_filename,
+                  const BatchOptions& options = BatchOptions())
+    : file_handler(out_filename, options) {
+  }
+  virtual ~BatchFileLogger() = default;
+
+  virtual void write(string_view msg) override {
+    file_handler.append(msg);
+  }
+};
+
+// Bounded, preallocated segments instead of one ever-growing file
+class SegmentedFileLogger : public ILogger {
+  SegmentedLogWriter writer;
+
+public:
+  SegmentedFileLogger(string_view out_prefix, size_t segment_size)
+    : writer(out_prefix, segment_size) {
+  }
+  virtual ~SegmentedFileLogger() = default;
+
+  virtual void write(string_view msg) override {
+    writer.append(msg);
+  }
+};
+
+// Text in independently compressed blocks with a time index; see
+// compressed_log.hpp.
+class CompressedFileLogger : public ILogger {
+  CompressedLogWriter writer;
+
+public:
+  CompressedFileLogger(string_view out_filename,
+                       size_t block_size = 64 * 1024)
+    : writer(out_filename, block_size) {
+  }
+  virtual ~CompressedFileLogger() = default;
+
+  virtual void write(string_view msg) override {
+    writer.append(sample_timestamp(), msg);
+  }
+
+  virtual void write_sample(const Sample& sample, string_view msg) override {
+    writer.append(sample.timestamp, msg);
+  }
+};
+
+// Keeps every sample in a compressed in-memory store for range and
+// downsampling queries; the store may be shared with readers.
+class TimeSeriesLogger : public ILogger {
+  TimeSeriesStore& store;
+
+public:
+  TimeSeriesLogger(TimeSeriesStore& store)
+    : store(store) {
+  }
+  virtual ~TimeSeriesLogger() = default;
+
+  virtual void write(string_view) override {
+  }
+
+  virtual void write_sample(const Sample& sample, string_view) override {
+    store.append(sample.resource_id, sample.timestamp,
+                 sample.value.as_double());
+  }
+};
+
+// Publishes every sample into a shared-memory ring that other processes
+// read with ShmRingReader; slow readers lose records, never the writer.
+class ShmRingLogger : public ILogger {
+  ShmRingWriter writer;
+
+public:
+  ShmRingLogger(string_view shm_name, uint32_t slot_count = 4096)
+    : writer(shm_name, slot_count) {
+  }
+  virtual ~ShmRingLogger() = default;
+
+  virtual void write(string_view msg) override {
+    writer.publish_text(sample_timestamp(), msg);
+  }
+
+  virtual void write_sample(const Sample& sample, string_view msg) override {
+    writer.publish(sample, msg);
+  }
+};
+
 template <typename Observer>
 struct IObserverable {
   virtual ~IObserverable() = default;
@@ -48,47 +167,225 @@ struct IObserverable {
   virtual void notify() = 0;
 };
 
-template <typename T>
-class ResourceManager {
-  unordered_map<string_view, T*> dict;
+// Fixed-size records behind a label/unit dictionary; see binary_log.hpp.
+// Resources added after construction are written with ids the header
+// does not name.
+class BinaryFileLogger : public ILogger {
+  FileHandler file_handler;
 
 public:
-  void add(string_view name, T& resource) {
-    if (dict.count(name))
-      throw invalid_argument(
-        "The name \""s + name.data() + "\" exists");
-    dict[name] = &resource;
+  BinaryFileLogger(string_view out_filename,
+                   ResourceManager<IMessage>& resource_manager)
+    : file_handler(out_filename, ios_base::out | ios_base::binary) {
+    vector<BinaryLogEntry> entries;
+    for (auto& [name, entry]:resource_manager.snapshot()) {
+      entries.push_back(BinaryLogEntry{entry.id,
+                                       string(entry.resource->label()),
+                                       string(entry.resource->unit())});
+    }
+    write_binary_log_header(file_handler.get(), entries);
   }
+  virtual ~BinaryFileLogger() = default;
 
-  void erase(string_view name) {
-    if (!dict.count(name))
-      throw invalid_argument(
-        "The name \""s + name.data() + "\" does not exist");
-    dict.erase(name);
+  virtual void write(string_view) override {
+  }
+
+  virtual void write_sample(const Sample& sample, string_view) override {
+    const BinaryLogRecord record(sample);
+    file_handler.get().write(reinterpret_cast<const char*>(&record),
+                             sizeof(record));
+  }
+};
+
+// Sits between a LoggingService and the real loggers. Keeps streaming
+// statistics per resource and forwards one summary line per resource and
+// window instead of every sample; notify() closes the open windows early.
+class StatisticsAggregator : public ILogger, public IObserverable<ILogger> {
+  struct ResourceStats {
+    string_view label;
+    string_view unit;
+    WindowedStats stats;
+  };
+
+  ResourceManager<IMessage>& resource_manager;
+  const vector<chrono::nanoseconds> windows;
+  vector<unique_ptr<ResourceStats>> resources;
+  ObserverList<ILogger> observers;
+  MessageArena arena;
+
+  ResourceStats& stats_of(uint32_t id) {
+    if (resources.size() <= id) resources.resize(id + 1);
+    if (!resources[id]) {
+      resources[id] = make_unique<ResourceStats>(
+        ResourceStats{"Resource"sv, ""sv, WindowedStats(windows)});
+      for (auto& [name, entry]:resource_manager.snapshot()) {
+        if (entry.id != id) continue;
+        resources[id]->label = entry.resource->label();
+        resources[id]->unit = entry.resource->unit();
+      }
+    }
+    return *resources[id];
+  }
+
+  void emit(const ResourceStats& resource, const WindowSummary& summary) {
+    arena.clear();
+    arena.stream() << resource.label << " ("
+                   << chrono::duration<double>(summary.window).count()
+                   << "s): count " << summary.count
+                   << ", min " << summary.min
+                   << ", mean " << summary.mean
+                   << ", p50 " << summary.p50
+                   << ", p95 " << summary.p95
+                   << ", p99 " << summary.p99
+                   << ", max " << summary.max
+                   << " " << resource.unit << "\n";
+    arena.commit();
+    for (auto& subscription:observers.snapshot())
+      subscription.observer->write(arena[0]);
+  }
+
+public:
+  StatisticsAggregator(ResourceManager<IMessage>& resource_manager,
+                       const vector<chrono::nanoseconds>& windows
+                         = {1s, 10s, 60s})
+    : resource_manager(resource_manager), windows(windows) {
+  }
+  virtual ~StatisticsAggregator() = default;
+
+  virtual void write(string_view) override {
+  }
+
+  virtual void write_sample(const Sample& sample, string_view) override {
+    auto& resource = stats_of(sample.resource_id);
+    resource.stats.record(sample.timestamp, sample.value.as_double(),
+                          [&](const WindowSummary& summary) {
+                            emit(resource, summary);
+                          });
+  }
+
+  virtual void subscribe(ILogger& obj) override {
+    observers.add(obj);
+  }
+
+  virtual void unsubscribe(ILogger& obj) override {
+    observers.remove(obj);
+  }
+
+  virtual void notify() override {
+    for (auto& resource:resources) {
+      if (!resource) continue;
+      resource->stats.flush([&](const WindowSummary& summary) {
+        emit(*resource, summary);
+      });
+    }
   }
+};
 
-  auto begin() {
-    return dict.begin();
+// Evaluates alert rules against every sample and tells its own
+// observers when an alert starts or clears.
+class AlertLogger : public ILogger, public IObserverable<ILogger> {
+  RuleEngine engine;
+  ObserverList<ILogger> observers;
+  MessageArena arena;
+
+public:
+  AlertLogger(const vector<AlertRule>& rules)
+    : engine(rules) {
   }
+  virtual ~AlertLogger() = default;
 
-  auto end() {
-    return dict.end();
+  virtual void write(string_view) override {
   }
 
-  auto cbegin() {
-    return dict.cbegin();
+  virtual void write_sample(const Sample& sample, string_view) override {
+    engine.evaluate(sample, [&](const AlertEvent& event) {
+      arena.clear();
+      arena.stream() << (event.firing ? "Alert firing: " : "Alert cleared: ")
+                     << event.rule.name << " (" << event.sample.value
+                     << ")\n";
+      arena.commit();
+      for (auto& subscription:observers.snapshot())
+        subscription.observer->write(arena[0]);
+    });
   }
 
-  auto cend() {
-    return dict.cend();
+  virtual void subscribe(ILogger& obj) override {
+    observers.add(obj);
+  }
+
+  virtual void unsubscribe(ILogger& obj) override {
+    observers.remove(obj);
+  }
+
+  virtual void notify() override {
+  }
+
+  size_t firing() const {
+    return engine.firing_count();
   }
 };
 
 template <typename Observer = ILogger>
 class LoggingService : public IObserverable<Observer> {
+protected:
   ResourceManager<IMessage>& resource_manager;
-  unordered_set<Observer*> observers;
+  ObserverList<Observer> observers;
   mutex mtx;
+  MessageArena arena;
+  vector<Sample> samples;
+  ServiceStats service_stats;
+  ChangeFilter change_filter;
+
+  static void format_one(MessageArena& arena, vector<Sample>& samples,
+                         const ResourceEntry<IMessage>& entry) {
+    IMessage& msg = *entry.resource;
+    Sample sample;
+    sample.value = msg.sample();
+    // Raw ticks until publish() or dispatch() converts them
+    sample.timestamp = sample_ticks();
+    sample.resource_id = entry.id;
+    char* buf = arena.prepare(IMessage::MAX_FORMATTED);
+    arena.commit(msg.format_to(buf, sample.value));
+    samples.push_back(sample);
+  }
+
+  // Samples and formats every resource once.
+  void format_all(MessageArena& arena, vector<Sample>& samples) {
+    arena.clear();
+    samples.clear();
+    for (auto& [name, entry]:resource_manager.snapshot())
+      format_one(arena, samples, entry);
+  }
+
+  void write_one(const Subscription<Observer>& subscription,
+                 const Sample& sample, string_view msg) {
+    const auto begin = service_stats.now();
+    subscription.observer->write_sample(sample, msg);
+    service_stats.write(subscription.observer, begin, service_stats.now());
+  }
+
+  void publish(MessageArena& arena, vector<Sample>& samples) {
+    auto subscriptions = observers.snapshot();
+    for (size_t i = 0; i < arena.size(); ++i) {
+      samples[i].timestamp = ticks_to_timestamp(samples[i].timestamp);
+      if (!change_filter.admit(samples[i])) continue;
+      service_stats.message(arena[i].size());
+      for (auto& subscription:subscriptions) {
+        if (subscription.filter.matches(samples[i].resource_id))
+          write_one(subscription, samples[i], arena[i]);
+      }
+    }
+  }
+
+  void dispatch(Sample sample, string_view msg) {
+    sample.timestamp = ticks_to_timestamp(sample.timestamp);
+    if (!change_filter.admit(sample)) return;
+    service_stats.message(msg.size());
+    for (auto& subscription:observers.snapshot()) {
+      if (subscription.filter.matches(sample.resource_id))
+        write_one(subscription, sample, msg);
+    }
+  }
 
 public:
   LoggingService(ResourceManager<IMessage>& resource_manager)
@@ -98,40 +395,657 @@ public:
   virtual ~LoggingService() = default;
 
   virtual void subscribe(Observer& obj) override {
-    scoped_lock<mutex>{mtx};
-    observers.insert(&obj);
+    observers.add(obj);
+  }
+
+  // Only the named resources reach obj; names must already be registered.
+  void subscribe(Observer& obj, initializer_list<string_view> names) {
+    ResourceFilter filter;
+    for (auto name:names) {
+      auto id = resource_manager.id(name);
+      if (!id)
+        throw invalid_argument(
+          "The name \""s + name.data() + "\" does not exist");
+      filter.add(*id);
+    }
+    observers.add(obj, filter);
   }
 
   virtual void unsubscribe(Observer& obj) override {
-    scoped_lock<mutex>{mtx};
-    if (observers.count(&obj))
-      observers.erase(&obj);
+    observers.remove(obj);
   }
 
   virtual void notify() override {
-    scoped_lock<mutex>{mtx};
-    auto itr = resource_manager.begin();
-    for (; itr != resource_manager.end(); ++itr) {
-      ostringstream oss;
-      oss << *(itr->second);
-      for (auto& observer:observers) {
-        observer->write(oss.str());
+    // Guards the arena; observers are read from an immutable snapshot
+    scoped_lock<mutex> lock {mtx};
+    const auto begin = service_stats.now();
+    format_all(arena, samples);
+    const auto formatted = service_stats.now();
+    publish(arena, samples);
+    service_stats.cycle(begin, formatted, service_stats.now());
+  }
+
+  // Samples a single resource, e.g. on its own cadence
+  void notify(const ResourceEntry<IMessage>& entry) {
+    scoped_lock<mutex> lock {mtx};
+    const auto begin = service_stats.now();
+    arena.clear();
+    samples.clear();
+    format_one(arena, samples, entry);
+    const auto formatted = service_stats.now();
+    publish(arena, samples);
+    service_stats.cycle(begin, formatted, service_stats.now());
+  }
+
+  // Samples name every period on the scheduler's thread. Remove the
+  // returned timer before erasing the resource.
+  size_t schedule(SamplingScheduler& scheduler, string_view name,
+                  SamplingScheduler::Clock::duration period) {
+    auto entry = resource_manager.entry(name);
+    if (!entry)
+      throw invalid_argument(
+        "The name \""s + name.data() + "\" does not exist");
+    return scheduler.add(period, [this, entry = *entry] { notify(entry); });
+  }
+
+  // From now on name's samples are written only when they leave the
+  // deadband around the last one written, or when its heartbeat is due.
+  void suppress(string_view name, const Deadband& deadband) {
+    auto id = resource_manager.id(name);
+    if (!id)
+      throw invalid_argument(
+        "The name \""s + name.data() + "\" does not exist");
+    change_filter.set(*id, deadband);
+  }
+
+  // Samples held back by suppress() deadbands so far
+  size_t suppressed() {
+    return change_filter.suppressed();
+  }
+
+  // Empty unless built with LOGGING_STATS
+  ServiceStatsSnapshot stats() {
+    return service_stats.stats();
+  }
+
+  // Writes stats() to out every period on the scheduler's thread
+  size_t dump_stats(SamplingScheduler& scheduler, ostream& out,
+                    SamplingScheduler::Clock::duration period) {
+    return scheduler.add(period, [this, &out] { out << stats(); });
+  }
+};
+
+// Sample and its preformatted message, copied by value through the ring.
+// Longer messages travel as several records, numbered from piece 0 and
+// tagged with the same message id.
+struct LogRecord {
+  static constexpr auto CAPACITY = 224u;
+  Sample sample;
+  uint32_t size = 0;
+  uint32_t message = 0;
+  uint32_t piece = 0;
+  bool continued = false;   // the message goes on in the next record
+  char text[CAPACITY];
+
+  static size_t pieces(size_t bytes) {
+    return max<size_t>(1, (bytes + CAPACITY - 1) / CAPACITY);
+  }
+
+  // False when msg was cut to CAPACITY
+  bool assign(const Sample& s, string_view msg) {
+    sample = s;
+    size = static_cast<uint32_t>(min<size_t>(msg.size(), CAPACITY));
+    piece = 0;
+    continued = false;
+    memcpy(text, msg.data(), size);
+    return size == msg.size();
+  }
+
+  void assign_piece(const Sample& s, string_view msg, size_t i,
+                    uint32_t id) {
+    assign(s, msg.substr(i * CAPACITY, CAPACITY));
+    message = id;
+    piece = static_cast<uint32_t>(i);
+    continued = (i + 1) * CAPACITY < msg.size();
+  }
+
+  string_view view() const {
+    return string_view(text, size);
+  }
+};
+
+// Puts split messages back together for an observer. A piece that does
+// not follow the one before, because earlier ones were dropped, is
+// discarded with the rest of its message.
+class RecordJoiner {
+  string joined;
+  uint32_t message = 0;
+  uint32_t next_piece = 0;
+
+  bool follows(const LogRecord& record) const {
+    return record.piece == next_piece &&
+           (record.piece == 0 || record.message == message);
+  }
+
+public:
+  template <typename Write>
+  void add(const LogRecord& record, Write&& write) {
+    if (!follows(record)) {
+      reset();
+      if (record.piece != 0) return;
+    }
+    if (record.continued) {
+      if (record.piece == 0) message = record.message;
+      joined.append(record.view());
+      next_piece = record.piece + 1;
+    } else if (joined.empty()) {
+      write(record.sample, record.view());
+    } else {
+      joined.append(record.view());
+      write(record.sample, string_view(joined));
+      reset();
+    }
+  }
+
+  void reset() {
+    joined.clear();
+    next_piece = 0;
+  }
+};
+
+struct AsyncOptions {
+  size_t capacity = 4096;
+  BackPressure back_pressure = BackPressure::Block;
+};
+
+struct SpillOptions {
+  size_t watermark = 1024;      // records queued in memory before spilling
+  size_t replay_batch = 256;    // records read back from the spill file at once
+};
+
+// Decorator that writes to a possibly slow observer on its own thread, so
+// write_sample() never waits for it. Records queue in memory up to the
+// watermark; beyond that they are appended to a spill file and stay
+// there until the observer has caught up with everything queued before
+// them. Order is kept and memory stays bounded however long the backlog.
+// Messages longer than a LogRecord travel as several records and are
+// joined again before the observer sees them. Spill file errors never
+// throw into the caller: the records involved are counted as lost and
+// the first error is kept for error() and the destructor.
+class SpillingLogger : public ILogger {
+  ILogger& inner;
+  const SpillOptions options;
+  const string spill_filename;
+  int fd = -1;
+
+  mutable mutex mtx;
+  condition_variable cv;
+  deque<LogRecord> queue;
+  uint64_t spill_read = 0;      // in records
+  uint64_t spill_write = 0;
+  bool spilling = false;
+  bool stopping = false;
+  size_t spilled_count = 0;
+  size_t lost_count = 0;        // in records
+  uint32_t next_message = 0;
+  string first_error;
+  thread worker;
+
+  void fail(const string& what) {
+    if (first_error.empty()) first_error = what;
+  }
+
+  bool spill(const LogRecord& record) {
+    const char* p = reinterpret_cast<const char*>(&record);
+    size_t n = sizeof(record);
+    off_t offset = static_cast<off_t>(spill_write * sizeof(record));
+    while (n > 0) {
+      const ssize_t written = ::pwrite(fd, p, n, offset);
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        fail("Cannot write "s + spill_filename + ": " + strerror(errno));
+        return false;
       }
+      p += written;
+      n -= written;
+      offset += written;
     }
+    ++spill_write;
+    return true;
+  }
+
+  bool replay(vector<LogRecord>& batch, uint64_t first) {
+    char* p = reinterpret_cast<char*>(batch.data());
+    size_t n = batch.size() * sizeof(LogRecord);
+    off_t offset = static_cast<off_t>(first * sizeof(LogRecord));
+    while (n > 0) {
+      const ssize_t got = ::pread(fd, p, n, offset);
+      if (got < 0 && errno == EINTR) continue;
+      if (got <= 0) return false;
+      p += got;
+      n -= got;
+      offset += got;
+    }
+    return true;
+  }
+
+  void enqueue(const Sample& sample, string_view msg) {
+    LogRecord record;
+    {
+      scoped_lock<mutex> lock {mtx};
+      // All pieces of a message go to the same place, memory or file
+      const bool to_memory = !spilling && queue.size() < options.watermark;
+      const uint64_t first = spill_write;
+      const size_t pieces = LogRecord::pieces(msg.size());
+      const uint32_t id = next_message++;
+      for (size_t i = 0; i < pieces; ++i) {
+        record.assign_piece(sample, msg, i, id);
+        if (to_memory) {
+          queue.push_back(record);
+        } else if (!spill(record)) {
+          // Pieces already written are not visible to the worker yet
+          spill_write = first;
+          lost_count += pieces;
+          return;
+        }
+      }
+      if (!to_memory) {
+        spilling = true;
+        ++spilled_count;
+      }
+    }
+    cv.notify_one();
+  }
+
+  void run() {
+    vector<LogRecord> batch;
+    RecordJoiner joiner;
+    unique_lock<mutex> lock {mtx};
+    for (;;) {
+      cv.wait(lock, [this] {
+        return stopping || !queue.empty() || spill_read < spill_write;
+      });
+      batch.clear();
+      if (!queue.empty()) {
+        // Everything in memory predates the spill file
+        while (!queue.empty() && batch.size() < options.replay_batch) {
+          batch.push_back(queue.front());
+          queue.pop_front();
+        }
+      } else if (spill_read < spill_write) {
+        const uint64_t first = spill_read;
+        batch.resize(min<uint64_t>(options.replay_batch,
+                                   spill_write - spill_read));
+        lock.unlock();
+        const bool read = replay(batch, first);
+        lock.lock();
+        if (read) {
+          spill_read += batch.size();
+        } else {
+          // The rest of the file is unreadable; start over in memory
+          fail("Cannot read back "s + spill_filename);
+          lost_count += spill_write - spill_read;
+          batch.clear();
+          joiner.reset();
+          spill_read = spill_write;
+        }
+        if (spill_read == spill_write) {
+          // Caught up: new records can stay in memory again. A file that
+          // cannot shrink is simply overwritten from the start.
+          if (::ftruncate(fd, 0) != 0)
+            fail("Cannot truncate "s + spill_filename + ": "
+                 + strerror(errno));
+          spill_read = spill_write = 0;
+          spilling = false;
+        }
+      } else {
+        break;
+      }
+      lock.unlock();
+      for (auto& record:batch)
+        joiner.add(record, [this](const Sample& sample, string_view msg) {
+          inner.write_sample(sample, msg);
+        });
+      lock.lock();
+    }
+  }
+
+public:
+  SpillingLogger(ILogger& inner, string_view spill_filename,
+                 const SpillOptions& options = SpillOptions())
+    : inner(inner), options(options), spill_filename(spill_filename) {
+    if (options.watermark == 0 || options.replay_batch == 0)
+      throw invalid_argument("Invalid spill options");
+    fd = ::open(this->spill_filename.c_str(),
+                O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+      throw runtime_error("Cannot open "s + this->spill_filename + ": "
+                          + strerror(errno));
+    worker = thread(&SpillingLogger::run, this);
+  }
+
+  // Delivers the whole backlog, including the spill file, before
+  // returning, and reports messages lost to spill file errors.
+  virtual ~SpillingLogger() {
+    {
+      scoped_lock<mutex> lock {mtx};
+      stopping = true;
+    }
+    cv.notify_one();
+    worker.join();
+    ::close(fd);
+    ::unlink(spill_filename.c_str());
+    if (lost_count > 0 || !first_error.empty())
+      cerr << "SpillingLogger: " << lost_count << " records lost, "
+           << first_error << endl;
+  }
+
+  virtual void write(string_view msg) override {
+    enqueue(Sample(), msg);
+  }
+
+  virtual void write_sample(const Sample& sample, string_view msg) override {
+    enqueue(sample, msg);
+  }
+
+  // Messages that went through the spill file so far
+  size_t spilled() const {
+    scoped_lock<mutex> lock {mtx};
+    return spilled_count;
+  }
+
+  // Records not yet written to the observer
+  size_t backlog() const {
+    scoped_lock<mutex> lock {mtx};
+    return queue.size() + (spill_write - spill_read);
+  }
+
+  // Records dropped because the spill file failed
+  size_t lost() const {
+    scoped_lock<mutex> lock {mtx};
+    return lost_count;
+  }
+
+  // The first spill file error, empty if none
+  string error() const {
+    scoped_lock<mutex> lock {mtx};
+    return first_error;
   }
 };
 
-void test(string_view out_filename, size_t count) {
+// notify() only formats and enqueues; a dedicated flusher thread drains
+// the ring to the observers, so the caller never waits on their I/O.
+// The flusher sleeps while the ring is empty, and notify() wakes it
+// only when it is asleep. Messages longer than a LogRecord go through
+// the ring as consecutive pieces and are joined again by the flusher.
+template <typename Observer = ILogger>
+class AsyncLoggingService : public LoggingService<Observer> {
+  const AsyncOptions options;
+  MpscRing<LogRecord> ring;
+  atomic<size_t> truncated_count {0};
+  atomic<uint32_t> next_message {0};
+  atomic<bool> running {true};
+  atomic<bool> idle {false};
+  mutex wake_mtx;
+  condition_variable wake;
+  condition_variable drained;
+  thread flusher;
+
+  void flush_loop() {
+    LogRecord record;
+    RecordJoiner joiner;
+    auto deliver = [this](const Sample& sample, string_view msg) {
+      this->dispatch(sample, msg);
+    };
+    for (;;) {
+      const bool stopping = !running.load(memory_order_acquire);
+      while (ring.pop(record)) joiner.add(record, deliver);
+      if (stopping) break;
+
+      unique_lock<mutex> lock {wake_mtx};
+      idle.store(true);
+      drained.notify_all();
+      // Pairs with the fence in wake_flusher(): either notify() sees
+      // idle, or the ring is seen non-empty here
+      atomic_thread_fence(memory_order_seq_cst);
+      if (ring.depth() == 0 && running.load())
+        wake.wait(lock, [this] { return !idle.load(); });
+      idle.store(false);
+    }
+  }
+
+  void wake_flusher() {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!idle.load(memory_order_relaxed)) return;
+    scoped_lock<mutex> lock {wake_mtx};
+    idle.store(false);
+    wake.notify_one();
+  }
+
+public:
+  AsyncLoggingService(ResourceManager<IMessage>& resource_manager,
+                      const AsyncOptions& options = AsyncOptions())
+    : LoggingService<Observer>(resource_manager),
+      options(options), ring(options.capacity),
+      flusher(&AsyncLoggingService::flush_loop, this) {
+  }
+
+  virtual ~AsyncLoggingService() {
+    running.store(false, memory_order_release);
+    {
+      scoped_lock<mutex> lock {wake_mtx};
+      idle.store(false);
+    }
+    wake.notify_one();
+    flusher.join();
+  }
+
+  // Waits until every record enqueued so far reached the observers
+  void drain() {
+    wake_flusher();
+    unique_lock<mutex> lock {wake_mtx};
+    drained.wait(lock, [this] { return idle.load() && ring.depth() == 0; });
+  }
+
+  virtual void notify() override {
+    // notify() may run on several producers at once
+    thread_local MessageArena local_arena;
+    thread_local vector<Sample> local_samples;
+    thread_local vector<LogRecord> pieces;
+    LogRecord record;
+    auto& service_stats = this->service_stats;
+    const auto begin = service_stats.now();
+    this->format_all(local_arena, local_samples);
+    const auto formatted = service_stats.now();
+    for (size_t i = 0; i < local_arena.size(); ++i) {
+      string_view msg = local_arena[i];
+      if (msg.size() <= LogRecord::CAPACITY) {
+        record.assign(local_samples[i], msg);
+        ring.push(record, options.back_pressure);
+        continue;
+      }
+      // Only a message that would not fit in the whole ring is cut
+      const size_t limit = ring.capacity() * LogRecord::CAPACITY;
+      if (msg.size() > limit) {
+        msg = msg.substr(0, limit);
+        truncated_count.fetch_add(1, memory_order_relaxed);
+      }
+      pieces.resize(LogRecord::pieces(msg.size()));
+      const uint32_t id = next_message.fetch_add(1, memory_order_relaxed);
+      for (size_t j = 0; j < pieces.size(); ++j)
+        pieces[j].assign_piece(local_samples[i], msg, j, id);
+      ring.push_all(pieces.data(), pieces.size(), options.back_pressure);
+    }
+    wake_flusher();
+    service_stats.cycle(begin, formatted, service_stats.now());
+  }
+
+  size_t drops() const {
+    return ring.drops();
+  }
+
+  // Messages cut because they were longer than the whole ring holds
+  size_t truncated() const {
+    return truncated_count.load(memory_order_relaxed);
+  }
+
+  size_t depth() const {
+    return ring.depth();
+  }
+
+  size_t high_water_mark() const {
+    return ring.high_water_mark();
+  }
+};
+
+// notify() over a ShardedResourceManager: the pool samples and formats
+// the shards in parallel, each into its own arena, then delivers to the
+// observers in parallel, one task per observer. Every observer gets the
+// shards in order, so it sees the same sequence as a serial walk would.
+// Distinct observers are written concurrently; observers sharing a sink
+// must synchronise on it.
+template <typename Observer = ILogger>
+class ShardedLoggingService : public IObserverable<Observer> {
+  struct Shard {
+    MessageArena arena;
+    vector<Sample> samples;
+  };
+
+  ShardedResourceManager<IMessage>& resource_manager;
+  WorkerPool& pool;
+  ObserverList<Observer> observers;
+  mutex mtx;
+  vector<unique_ptr<Shard>> shards;
+  ServiceStats service_stats;
+
+  void format_shard(size_t i) {
+    Shard& shard = *shards[i];
+    shard.arena.clear();
+    shard.samples.clear();
+    for (auto& [name, entry]:resource_manager.shard(i).snapshot()) {
+      IMessage& msg = *entry.resource;
+      Sample sample;
+      sample.value = msg.sample();
+      sample.timestamp = sample_ticks();
+      sample.resource_id = entry.id;
+      char* buf = shard.arena.prepare(IMessage::MAX_FORMATTED);
+      const size_t written = msg.format_to(buf, sample.value);
+      shard.arena.commit(written);
+      shard.samples.push_back(sample);
+      service_stats.message(written);
+    }
+    // Converted here rather than per observer in deliver()
+    for (auto& sample:shard.samples)
+      sample.timestamp = ticks_to_timestamp(sample.timestamp);
+  }
+
+  void deliver(const Subscription<Observer>& subscription) {
+    for (auto& shard:shards) {
+      for (size_t i = 0; i < shard->arena.size(); ++i) {
+        const Sample& sample = shard->samples[i];
+        if (!subscription.filter.matches(sample.resource_id)) continue;
+        const auto begin = service_stats.now();
+        subscription.observer->write_sample(sample, shard->arena[i]);
+        service_stats.write(subscription.observer, begin, service_stats.now());
+      }
+    }
+  }
+
+public:
+  ShardedLoggingService(ShardedResourceManager<IMessage>& resource_manager,
+                        WorkerPool& pool)
+    : resource_manager(resource_manager), pool(pool) {
+    for (size_t i = 0; i < resource_manager.shard_count(); ++i)
+      shards.push_back(make_unique<Shard>());
+  }
+
+  virtual ~ShardedLoggingService() = default;
+
+  virtual void subscribe(Observer& obj) override {
+    observers.add(obj);
+  }
+
+  // Only the named resources reach obj; names must already be registered.
+  void subscribe(Observer& obj, initializer_list<string_view> names) {
+    ResourceFilter filter;
+    for (auto name:names) {
+      auto id = resource_manager.id(name);
+      if (!id)
+        throw invalid_argument(
+          "The name \""s + name.data() + "\" does not exist");
+      filter.add(*id);
+    }
+    observers.add(obj, filter);
+  }
+
+  virtual void unsubscribe(Observer& obj) override {
+    observers.remove(obj);
+  }
+
+  virtual void notify() override {
+    // Guards the shard arenas
+    scoped_lock<mutex> lock {mtx};
+    const auto begin = service_stats.now();
+    pool.run(shards.size(), [this](size_t i) { format_shard(i); });
+    const auto formatted = service_stats.now();
+    auto subscriptions = observers.snapshot();
+    pool.run(subscriptions->size(), [&](size_t i) {
+      deliver((*subscriptions)[i]);
+    });
+    service_stats.cycle(begin, formatted, service_stats.now());
+  }
+
+  // Empty unless built with LOGGING_STATS
+  ServiceStatsSnapshot stats() {
+    return service_stats.stats();
+  }
+};
+
+// Stands in for a file on a slow network share
+class SlowLogger : public ILogger {
+  FileLogger file_logger;
+
+public:
+  SlowLogger(string_view out_filename)
+    : file_logger(out_filename) {
+  }
+  virtual ~SlowLogger() = default;
+
+  virtual void write(string_view msg) override {
+    this_thread::sleep_for(20us);
+    file_logger.write(msg);
+  }
+};
+
+// The four mock resources that test() and the benchmark sample
+struct ResourceFixture {
   CpuUtilizationMessage cpu_usage;
   DiskUtilizationMessage disk_usage;
   MemoryUtilizationMessage memory_usage;
   NetworkUtilizationMessage network_usage;
-
   ResourceManager<IMessage> resource_manager;
-  resource_manager.add("CPU"sv, cpu_usage);
-  resource_manager.add("Disk"sv, disk_usage);
-  resource_manager.add("Memory"sv, memory_usage);
-  resource_manager.add("Network"sv, network_usage);
+
+  ResourceFixture() {
+    add_to(resource_manager);
+  }
+
+  // Also registers them with another registry, e.g. a sharded one
+  template <typename Manager>
+  void add_to(Manager& manager) {
+    manager.add("CPU"sv, cpu_usage);
+    manager.add("Disk"sv, disk_usage);
+    manager.add("Memory"sv, memory_usage);
+    manager.add("Network"sv, network_usage);
+  }
+};
+
+void test(string_view out_filename, size_t count) {
+  ResourceFixture resources;
+  auto& resource_manager = resources.resource_manager;
+  auto run = [count](auto& service) {
+    for (size_t i = 0; i < count; ++i)
+      service.notify();
+  };
 
   ConsoleLogger console_logger;
   FileLogger file_logger(out_filename);
@@ -139,12 +1053,168 @@ void test(string_view out_filename, size_t count) {
   LoggingService<> logging_service(resource_manager);
   logging_service.subscribe(console_logger);
   logging_service.subscribe(file_logger);
-  for (size_t i = 0; i < count; ++i)
-    logging_service.notify();
+
+  BinaryFileLogger binary_logger("resource.bin"sv, resource_manager);
+  logging_service.subscribe(binary_logger);
+
+  BatchOptions batch_options;
+  batch_options.batch_bytes = 64 * 1024;
+  batch_options.durability = Durability::SyncPerInterval;
+  BatchFileLogger batch_logger("resource_batch.log"sv, batch_options);
+  logging_service.subscribe(batch_logger);
+
+  SegmentedFileLogger segmented_logger("resource_segment.log"sv, 32 * 1024);
+  logging_service.subscribe(segmented_logger);
+
+  FileLogger filtered_logger("resource_filtered.log"sv);
+  logging_service.subscribe(filtered_logger, {"Memory"sv, "Disk"sv});
+
+  FileLogger statistics_logger("resource_statistics.log"sv);
+  StatisticsAggregator statistics(resource_manager);
+  statistics.subscribe(statistics_logger);
+  logging_service.subscribe(statistics);
+
+  ShmRingLogger shm_logger("/resource-ring"sv);
+  ShmRingReader shm_reader("/resource-ring"sv);
+  logging_service.subscribe(shm_logger);
+
+  CompressedFileLogger compressed_logger("resource.lz"sv);
+  logging_service.subscribe(compressed_logger);
+
+  TimeSeriesStore store;
+  TimeSeriesLogger time_series_logger(store);
+  logging_service.subscribe(time_series_logger);
+  const uint64_t begin = sample_timestamp();
+
+  const uint32_t cpu = *resource_manager.id("CPU"sv);
+  const uint32_t memory = *resource_manager.id("Memory"sv);
+  AlertLogger alerts({
+    {"CPU > 95 %", cpu, Comparison::Above, 95},
+    {"CPU < 5 % for 2 samples", cpu, Comparison::Below, 5, 2},
+    {"Memory > 1800 GB for 3 samples, until < 1500 GB", memory,
+     Comparison::Above, 1800, 3, 1500},
+  });
+  FileLogger alerts_logger("resource_alerts.log"sv);
+  alerts.subscribe(alerts_logger);
+  logging_service.subscribe(alerts);
+
+  run(logging_service);
+  if (ServiceStats::ENABLED) cerr << logging_service.stats();
+  statistics.notify();
+
+  ShmRecord record;
+  size_t received = 0;
+  while (shm_reader.poll(record)) ++received;
+  cout << "shm ring: received " << received
+       << ", lost " << shm_reader.lost() << endl;
+
+  const uint64_t end = sample_timestamp();
+  const auto buckets = store.downsample(*resource_manager.id("CPU"sv),
+                                        begin, end, (end - begin) / 4 + 1);
+  cerr << "time series: " << store.points() << " points in "
+       << store.memory_bytes() << " bytes";
+  for (auto& bucket:buckets)
+    cerr << ", CPU mean " << bucket.mean << " of " << bucket.count;
+  cerr << endl;
+  cerr << "alerts: " << alerts.firing() << " firing" << endl;
+
+  {
+    FileLogger async_logger("resource_async.log"sv);
+    AsyncOptions options;
+    options.back_pressure = BackPressure::DropOldest;
+    AsyncLoggingService<> async_service(resource_manager, options);
+    async_service.subscribe(async_logger);
+    run(async_service);
+    cerr << "async: dropped " << async_service.drops()
+         << ", truncated " << async_service.truncated()
+         << ", max depth " << async_service.high_water_mark() << endl;
+  }
+
+  {
+    ProcCpuUtilizationMessage cpu_usage;
+    ProcDiskUtilizationMessage disk_usage;
+    ProcMemoryUtilizationMessage memory_usage;
+    ProcNetworkUtilizationMessage network_usage;
+    ResourceManager<IMessage> proc_manager;
+    proc_manager.add("CPU"sv, cpu_usage);
+    proc_manager.add("Disk"sv, disk_usage);
+    proc_manager.add("Memory"sv, memory_usage);
+    proc_manager.add("Network"sv, network_usage);
+
+    FileLogger proc_logger("resource_proc.log"sv);
+    LoggingService<> proc_service(proc_manager);
+    proc_service.subscribe(proc_logger);
+    run(proc_service);
+  }
+
+  {
+    FileLogger scheduled_logger("resource_scheduled.log"sv);
+    LoggingService<> scheduled_service(resource_manager);
+    scheduled_service.subscribe(scheduled_logger);
+
+    SamplingScheduler scheduler;
+    scheduled_service.schedule(scheduler, "CPU"sv, 10ms);
+    scheduled_service.schedule(scheduler, "Memory"sv, 50ms);
+    scheduled_service.schedule(scheduler, "Network"sv, 100ms);
+    scheduled_service.schedule(scheduler, "Disk"sv, 5s);
+    if (ServiceStats::ENABLED)
+      scheduled_service.dump_stats(scheduler, cerr, 250ms);
+    this_thread::sleep_for(500ms);
+    cerr << "scheduled: fired " << scheduler.fired()
+         << ", missed " << scheduler.missed() << endl;
+  }
+
+  {
+    ShardedResourceManager<IMessage> sharded_manager(4);
+    resources.add_to(sharded_manager);
+    FileLogger sharded_logger("resource_sharded.log"sv);
+    FileLogger cpu_logger("resource_sharded_cpu.log"sv);
+
+    WorkerPool pool(4);
+    ShardedLoggingService<> sharded_service(sharded_manager, pool);
+    sharded_service.subscribe(sharded_logger);
+    sharded_service.subscribe(cpu_logger, {"CPU"sv});
+    run(sharded_service);
+  }
+
+  {
+    FileLogger suppressed_logger("resource_suppressed.log"sv);
+    LoggingService<> suppressed_service(resource_manager);
+    suppressed_service.subscribe(suppressed_logger);
+    suppressed_service.suppress("CPU"sv, Deadband{40, 0, 1ms});
+    suppressed_service.suppress("Memory"sv, Deadband{0, 0.5});
+    suppressed_service.suppress("Disk"sv, Deadband{100, 0.5, 10ms});
+    run(suppressed_service);
+    cerr << "suppressed: " << suppressed_service.suppressed() << " of "
+         << 4 * count << " samples" << endl;
+  }
+
+  {
+    SlowLogger slow_logger("resource_spilling.log"sv);
+    FileLogger fast_logger("resource_spilling_fast.log"sv);
+    size_t spilled;
+    {
+      SpillingLogger spilling_logger(slow_logger, "resource_spilling.spill"sv,
+                                     SpillOptions{256, 64});
+      LoggingService<> spilling_service(resource_manager);
+      spilling_service.subscribe(spilling_logger);
+      spilling_service.subscribe(fast_logger);
+      const auto begin = chrono::steady_clock::now();
+      run(spilling_service);
+      const auto elapsed = chrono::steady_clock::now() - begin;
+      cerr << "spilling: notify took "
+           << chrono::duration<double, micro>(elapsed).count() / count
+           << " us, backlog " << spilling_logger.backlog() << " records";
+      spilled = spilling_logger.spilled();
+    }
+    cerr << ", " << spilled << " records spilled" << endl;
+  }
 }
 
+#ifndef BENCHMARK
 int main() {
   test("resource.log"sv, 1000);
 
   return 0;
 }
+#endif
@@ -1,11 +1,12 @@
-#include <unordered_map>
 #include <unordered_set>
 #include <mutex>
 #include <sstream>
 #include <iostream>
 #include <memory>
+#include <vector>
 
 #include "message.hpp"
+#include "resource_manager.hpp"
 #include "file_handler.hpp"
 
 using namespace std;
@@ -51,37 +52,37 @@ struct IObserverable {
   virtual void notify() = 0;
 };
 
-template <typename T>
-class ResourceManager {
-  unordered_map<string_view, T*> dict;
-
-public:
-  void add(string_view name, T& resource) {
-    if (dict.count(name))
-      throw invalid_argument("The name \""s + name.data() + "\" exists");
-    dict[name] = &resource;
-  }
+struct SnapshotEntry {
+  string_view name;
+  IMessage* message;
+  Value value;
+};
 
-  void erase(string_view name) {
-    if (!dict.count(name))
-      throw invalid_argument("The name \""s + name.data() + "\" does not exist");
-    dict.erase(name);
-  }
+// Every resource sampled once by notify(); all observers of a cycle read
+// the same values, and sampling cost no longer grows with observers.
+class Snapshot {
+  uint64_t timestamp = 0;
+  vector<SnapshotEntry> entries;
 
-  auto begin() {
-    return dict.begin();
+public:
+  void take(ResourceManager<IMessage>& resource_manager) {
+    entries.clear();
+    timestamp = sample_timestamp();
+    for (auto& [name, entry]:resource_manager.snapshot())
+      entries.push_back(SnapshotEntry{name, entry.resource,
+                                      entry.resource->sample()});
   }
 
-  auto end() {
-    return dict.end();
+  uint64_t get_timestamp() const {
+    return timestamp;
   }
 
-  auto cbegin() {
-    return dict.cbegin();
+  auto begin() const {
+    return entries.cbegin();
   }
 
-  auto cend() {
-    return dict.cend();
+  auto end() const {
+    return entries.cend();
   }
 };
 
@@ -90,6 +91,7 @@ class LoggingService : public IObserverable<Observer> {
   ResourceManager<IMessage>& resource_manager;
   unordered_set<Observer*> observers;
   mutex mtx;
+  Snapshot snapshot;
 
 public:
   LoggingService(ResourceManager<IMessage>& resource_manager)
@@ -99,18 +101,19 @@ public:
   virtual ~LoggingService() = default;
 
   virtual void subscribe(Observer& obj) override {
-    scoped_lock<mutex>{mtx};
+    scoped_lock<mutex> lock {mtx};
     observers.insert(&obj);
   }
 
   virtual void unsubscribe(Observer& obj) override {
-    scoped_lock<mutex>{mtx};
+    scoped_lock<mutex> lock {mtx};
     if (observers.count(&obj))
       observers.erase(&obj);
   }
 
   virtual void notify() override {
-    scoped_lock<mutex>{mtx};
+    scoped_lock<mutex> lock {mtx};
+    snapshot.take(resource_manager);
     for (auto& observer:observers) {
       observer->write(this);
     }
@@ -119,53 +122,63 @@ public:
   ResourceManager<IMessage>& get_resource_manager() {
     return resource_manager;
   }
+
+  // Valid while the current notify() runs
+  const Snapshot& get_snapshot() const {
+    return snapshot;
+  }
 };
 
 void ConsoleLogger::write(IObserverable<ILogger>* subject) {
   LoggingService<ILogger>* logging_service
     = reinterpret_cast<LoggingService<ILogger>*>(subject);
-  auto itr = logging_service->get_resource_manager().begin();
-  auto end = logging_service->get_resource_manager().end();
-  for (; itr != end; ++itr) {
-    cout << *(itr->second);
+  for (auto& entry:logging_service->get_snapshot()) {
+    format(cout, *entry.message, entry.value);
   }
 }
 
 void FileLogger::write(IObserverable<ILogger>* subject) {
   LoggingService<ILogger>* logging_service
     = reinterpret_cast<LoggingService<ILogger>*>(subject);
-  auto itr = logging_service->get_resource_manager().begin();
-  auto end = logging_service->get_resource_manager().end();
   auto& out = file_handler.get();
-  for (; itr != end; ++itr) {
-    out << *(itr->second);
+  for (auto& entry:logging_service->get_snapshot()) {
+    format(out, *entry.message, entry.value);
   }
 }
 
-void test(string_view out_filename, size_t count) {
+// The four mock resources that test() and the benchmark sample
+struct ResourceFixture {
   CpuUtilizationMessage cpu_usage;
   DiskUtilizationMessage disk_usage;
   MemoryUtilizationMessage memory_usage;
   NetworkUtilizationMessage network_usage;
-
   ResourceManager<IMessage> resource_manager;
-  resource_manager.add("CPU"sv, cpu_usage);
-  resource_manager.add("Disk"sv, disk_usage);
-  resource_manager.add("Memory"sv, memory_usage);
-  resource_manager.add("Network"sv, network_usage);
+
+  ResourceFixture() {
+    resource_manager.add("CPU"sv, cpu_usage);
+    resource_manager.add("Disk"sv, disk_usage);
+    resource_manager.add("Memory"sv, memory_usage);
+    resource_manager.add("Network"sv, network_usage);
+  }
+};
+
+void test(string_view out_filename, size_t count) {
+  ResourceFixture resources;
 
   ConsoleLogger console_logger;
   FileLogger file_logger(out_filename);
 
-  LoggingService<> logging_service(resource_manager);
+  LoggingService<> logging_service(resources.resource_manager);
   logging_service.subscribe(console_logger);
   logging_service.subscribe(file_logger);
   for (size_t i = 0; i < count; ++i)
     logging_service.notify();
 }
 
+#ifndef BENCHMARK
 int main() {
   test("resource.log"sv, 1000);
 
   return 0;
 }
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+// Shared harness of the benchmark_*_model programs, which include the
+// week's programs with BENCHMARK defined to leave out their main().
+struct BenchmarkResult {
+  double messages_per_second;
+  double p50;    // notify latency in nanoseconds
+  double p99;
+  double p999;
+};
+
+// Times every call of notify(), which emits messages_per_cycle messages,
+// after a tenth as many warm-up calls. The throughput also counts drain(),
+// which waits for messages still queued when the last call returns.
+template <typename F, typename Drain>
+BenchmarkResult run_benchmark(size_t cycles, size_t messages_per_cycle,
+                              F&& notify, Drain&& drain) {
+  using Clock = std::chrono::steady_clock;
+  for (size_t i = 0; i < cycles / 10; ++i) notify();
+
+  std::vector<uint64_t> latencies(cycles);
+  const auto begin = Clock::now();
+  auto last = begin;
+  for (auto& latency:latencies) {
+    notify();
+    const auto now = Clock::now();
+    latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      now - last).count();
+    last = now;
+  }
+  drain();
+  const double seconds =
+    std::chrono::duration<double>(Clock::now() - begin).count();
+
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double q) {
+    return static_cast<double>(
+      latencies[std::min(latencies.size() - 1,
+                         static_cast<size_t>(q * latencies.size()))]);
+  };
+  return BenchmarkResult{cycles * messages_per_cycle / seconds,
+                         percentile(0.5), percentile(0.99), percentile(0.999)};
+}
+
+template <typename F>
+BenchmarkResult run_benchmark(size_t cycles, size_t messages_per_cycle,
+                              F&& notify) {
+  return run_benchmark(cycles, messages_per_cycle, notify, [] {});
+}
+
+inline void print_result(std::string_view program, std::string_view sink,
+                         size_t observers, const BenchmarkResult& result) {
+  std::cout << std::left << std::setw(14) << program << std::setw(9) << sink
+            << std::right << std::setw(3) << observers << " observers "
+            << std::fixed << std::setprecision(0)
+            << std::setw(10) << result.messages_per_second << " msgs/s, p50 "
+            << std::setw(8) << result.p50 << " ns, p99 "
+            << std::setw(8) << result.p99 << " ns, p999 "
+            << std::setw(8) << result.p999 << " ns"
+            << std::defaultfloat << std::setprecision(6) << std::endl;
+}
+
+// Sends std::cout to /dev/null while alive
+class DiscardConsole {
+  std::ofstream null {"/dev/null"};
+  std::streambuf* saved;
+
+public:
+  DiscardConsole()
+    : saved(std::cout.rdbuf(null.rdbuf())) {
+  }
+
+  DiscardConsole(const DiscardConsole&) = delete;
+  DiscardConsole& operator=(const DiscardConsole&) = delete;
+
+  virtual ~DiscardConsole() {
+    std::cout.flush();
+    std::cout.rdbuf(saved);
+  }
+};
+
+// A file name on tmpfs, so file sinks measure the logger, not the disk
+inline std::string tmpfs_path(std::string_view name) {
+  const char* dir = ::access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp";
+  return std::string(dir) + "/" + std::string(name);
+}
+
+constexpr size_t BENCHMARK_OBSERVERS[] = {1, 4, 32};
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "message.hpp"
+#include "message_arena.hpp"
+#include "file_handler.hpp"
+#include "compressed_log.hpp"
+
+using namespace std;
+
+// Write throughput and on-disk size of the plain, batched and block
+// compressed loggers for the same messages, then the cost of reading
+// one block against decompressing the whole file.
+size_t file_size(const char* filename) {
+  struct stat st;
+  return ::stat(filename, &st) == 0 ? st.st_size : 0;
+}
+
+template <typename F>
+double seconds(F&& f) {
+  const auto begin = chrono::steady_clock::now();
+  f();
+  return chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+}
+
+void report(string_view name, double elapsed, size_t count,
+            size_t text_bytes, size_t file_bytes) {
+  cout << left << setw(20) << name << right << fixed << setprecision(1)
+       << setw(8) << elapsed * 1e9 / count << " ns/message, "
+       << setw(8) << text_bytes / elapsed / 1e6 << " MB/s, "
+       << setw(10) << file_bytes << " bytes, ratio " << setprecision(2)
+       << double(text_bytes) / file_bytes
+       << defaultfloat << setprecision(6) << endl;
+}
+
+int main() {
+  constexpr size_t CYCLES = 100000;
+
+  CpuUtilizationMessage cpu_usage;
+  DiskUtilizationMessage disk_usage;
+  MemoryUtilizationMessage memory_usage;
+  NetworkUtilizationMessage network_usage;
+  IMessage* messages[] = {&cpu_usage, &disk_usage, &memory_usage,
+                          &network_usage};
+
+  // Formatted up front so only the writers are timed
+  MessageArena arena;
+  vector<uint64_t> timestamps;
+  for (size_t i = 0; i < CYCLES; ++i) {
+    for (auto message:messages) {
+      format(arena.stream(), *message, message->sample());
+      arena.commit();
+      timestamps.push_back(sample_timestamp());
+    }
+  }
+  const size_t count = arena.size();
+  size_t text_bytes = 0;
+  for (size_t i = 0; i < count; ++i) text_bytes += arena[i].size();
+
+  const double plain = seconds([&] {
+    FileHandler file_handler("benchmark.log");
+    auto& out = file_handler.get();
+    for (size_t i = 0; i < count; ++i) out << arena[i];
+  });
+  report("FileHandler", plain, count, text_bytes, file_size("benchmark.log"));
+
+  const double batch = seconds([&] {
+    BatchFileHandler file_handler("benchmark_batch.log");
+    for (size_t i = 0; i < count; ++i) file_handler.append(arena[i]);
+  });
+  report("BatchFileHandler", batch, count, text_bytes,
+         file_size("benchmark_batch.log"));
+
+  for (size_t block_size:{16 * 1024, 64 * 1024, 256 * 1024}) {
+    const double compressed = seconds([&] {
+      CompressedLogWriter writer("benchmark.lz", block_size);
+      for (size_t i = 0; i < count; ++i)
+        writer.append(timestamps[i], arena[i]);
+    });
+    report("CompressedLog " + to_string(block_size / 1024) + "K",
+           compressed, count, text_bytes, file_size("benchmark.lz"));
+  }
+
+  CompressedLogReader reader("benchmark.lz");
+  const auto& blocks = reader.blocks();
+  const auto& middle = blocks[blocks.size() / 2];
+  size_t range_bytes = 0, all_bytes = 0;
+  const double range = seconds([&] {
+    reader.read_range(middle.first_timestamp, middle.last_timestamp,
+                      [&](string_view text) { range_bytes += text.size(); });
+  });
+  const double all = seconds([&] {
+    reader.read_range(0, UINT64_MAX,
+                      [&](string_view text) { all_bytes += text.size(); });
+  });
+  cout << fixed << setprecision(1)
+       << "range read: " << range_bytes << " bytes in " << range * 1e6
+       << " us, whole file: " << all_bytes << " bytes in " << all * 1e6
+       << " us (" << all_bytes / all / 1e6 << " MB/s)"
+       << defaultfloat << setprecision(6) << endl;
+  return 0;
+}
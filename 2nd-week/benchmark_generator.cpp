@@ -0,0 +1,126 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string_view>
+#include <thread>
+
+#include "generator.hpp"
+
+using namespace std;
+
+// The generator as it was: std::mt19937 behind uniform_int_distribution
+template <typename T>
+class LegacyNumericGenerator : public IGenerator<T> {
+  std::mt19937 gen;
+  std::uniform_int_distribution<T> dist;
+
+public:
+  LegacyNumericGenerator(T from, T to)
+    : gen(1729u), dist(from, to) {
+  }
+
+  virtual T get() override {
+    return dist(gen);
+  }
+};
+
+constexpr size_t COUNT = 1 << 24;
+constexpr size_t BATCH = 1024;
+
+template <typename T>
+void report(string_view name, chrono::steady_clock::duration elapsed,
+            const vector<T>& values) {
+  const double seconds = chrono::duration<double>(elapsed).count();
+  T checksum = 0;
+  for (auto v:values) checksum += v;
+  cout << left << setw(44) << name << right << setw(8) << fixed
+       << setprecision(1) << COUNT / seconds / 1e6 << " M values/s"
+       << defaultfloat << setprecision(6) << "  (checksum " << checksum << ")" << endl;
+}
+
+template <typename T>
+void measure_get(string_view name, IGenerator<T>& generator) {
+  vector<T> values(BATCH);
+  const auto begin = chrono::steady_clock::now();
+  for (size_t i = 0; i < COUNT; i += BATCH)
+    for (size_t j = 0; j < BATCH; ++j) values[j] = generator.get();
+  report(name, chrono::steady_clock::now() - begin, values);
+}
+
+template <typename T>
+void measure_fill(string_view name, IGenerator<T>& generator) {
+  vector<T> values(BATCH);
+  const auto begin = chrono::steady_clock::now();
+  for (size_t i = 0; i < COUNT; i += BATCH)
+    generator.fill(values.data(), values.size());
+  report(name, chrono::steady_clock::now() - begin, values);
+}
+
+// Every worker draws from its own split stream; running twice must give
+// bit-identical results regardless of scheduling.
+template <typename Engine>
+void measure_streams(string_view name, size_t threads) {
+  RandomNumericGenerator<int, Engine> parent(0, 100, 42);
+  auto run = [&] {
+    vector<uint64_t> checksums(threads);
+    vector<thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+      workers.emplace_back([&, t] {
+        auto stream = parent.split(t);
+        vector<int> values(BATCH);
+        uint64_t checksum = 0;
+        for (size_t i = 0; i < COUNT / threads; i += BATCH) {
+          stream.fill(values.data(), values.size());
+          for (auto v:values) checksum = checksum * 31 + v;
+        }
+        checksums[t] = checksum;
+      });
+    }
+    for (auto& worker:workers) worker.join();
+    return checksums;
+  };
+  const auto begin = chrono::steady_clock::now();
+  const auto first = run();
+  const auto elapsed = chrono::steady_clock::now() - begin;
+  const auto second = run();
+  size_t distinct = 0;
+  for (size_t t = 0; t < threads; ++t)
+    for (size_t u = t + 1; u < threads; ++u)
+      distinct += first[t] != first[u];
+  cout << left << setw(44) << name << right << setw(8) << fixed
+       << setprecision(1)
+       << COUNT / chrono::duration<double>(elapsed).count() / 1e6
+       << " M values/s" << defaultfloat << setprecision(6) << "  ("
+       << threads << " streams, "
+       << (first == second ? "reproducible" : "NOT reproducible") << ", "
+       << distinct << "/" << threads * (threads - 1) / 2
+       << " pairs distinct)" << endl;
+}
+
+int main() {
+  LegacyNumericGenerator<int> legacy(0, 100);
+  RandomNumericGenerator<int> mt(0, 100);
+  RandomNumericGenerator<int, Xoshiro256StarStar> xoshiro(0, 100);
+  RandomNumericGenerator<int, Pcg64> pcg(0, 100);
+  RandomNumericGenerator<int, SplitMix64> splitmix(0, 100);
+
+  measure_get("legacy mt19937 + distribution, get()", legacy);
+  measure_get("mt19937 + Lemire, get()", mt);
+  measure_fill("mt19937 + Lemire, fill()", mt);
+  measure_get("xoshiro256** + Lemire, get()", xoshiro);
+  measure_fill("xoshiro256** + Lemire, fill()", xoshiro);
+  measure_fill("pcg64 + Lemire, fill()", pcg);
+  measure_fill("splitmix64 + Lemire, fill()", splitmix);
+
+  RandomFloatingGenerator<double> mt_real(1, 1e3);
+  RandomFloatingGenerator<double, Xoshiro256StarStar> xoshiro_real(1, 1e3);
+  measure_get("mt19937 double, get()", mt_real);
+  measure_fill("xoshiro256** double, fill()", xoshiro_real);
+
+  RandomNumericGenerator<int, Philox4x32> philox(0, 100);
+  measure_fill("philox4x32-10 + Lemire, fill()", philox);
+  measure_streams<Philox4x32>("philox4x32-10 split streams", 8);
+  measure_streams<Xoshiro256StarStar>("xoshiro256** jump streams", 8);
+  return 0;
+}
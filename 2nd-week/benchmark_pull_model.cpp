@@ -0,0 +1,42 @@
+#include "3_apply_observer_pattern_using_pull_model.cpp"
+#include "benchmark.hpp"
+
+template <typename Logger, typename MakeLogger>
+BenchmarkResult measure(size_t observer_count, size_t cycles,
+                        MakeLogger&& make_logger) {
+  ResourceFixture resources;
+
+  vector<unique_ptr<Logger>> loggers;
+  for (size_t i = 0; i < observer_count; ++i)
+    loggers.push_back(make_logger(i));
+
+  LoggingService<> logging_service(resources.resource_manager);
+  for (auto& logger:loggers) logging_service.subscribe(*logger);
+  return run_benchmark(cycles, 4, [&] { logging_service.notify(); });
+}
+
+int main() {
+  constexpr size_t CYCLES = 20000;
+  for (auto observers:BENCHMARK_OBSERVERS) {
+    BenchmarkResult result;
+    {
+      DiscardConsole discard;
+      result = measure<ConsoleLogger>(observers, CYCLES, [](size_t) {
+        return make_unique<ConsoleLogger>();
+      });
+    }
+    print_result("pull", "console", observers, result);
+  }
+
+  for (auto observers:BENCHMARK_OBSERVERS) {
+    vector<string> paths;
+    for (size_t i = 0; i < observers; ++i)
+      paths.push_back(tmpfs_path("benchmark_pull." + to_string(i) + ".log"));
+    const auto result = measure<FileLogger>(observers, CYCLES, [&](size_t i) {
+      return make_unique<FileLogger>(paths[i]);
+    });
+    print_result("pull", "file", observers, result);
+    for (auto& path:paths) ::unlink(path.c_str());
+  }
+  return 0;
+}
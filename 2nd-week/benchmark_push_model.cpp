@@ -0,0 +1,59 @@
+#include "2_apply_observer_pattern_using_push_model.cpp"
+#include "benchmark.hpp"
+
+void drain(LoggingService<>&) {
+}
+
+void drain(AsyncLoggingService<>& logging_service) {
+  logging_service.drain();
+}
+
+template <typename Service, typename Logger, typename MakeLogger>
+BenchmarkResult measure(size_t observer_count, size_t cycles,
+                        MakeLogger&& make_logger) {
+  ResourceFixture resources;
+
+  vector<unique_ptr<Logger>> loggers;
+  for (size_t i = 0; i < observer_count; ++i)
+    loggers.push_back(make_logger(i));
+
+  Service logging_service(resources.resource_manager);
+  for (auto& logger:loggers) logging_service.subscribe(*logger);
+  return run_benchmark(cycles, 4, [&] { logging_service.notify(); },
+                       [&] { drain(logging_service); });
+}
+
+template <typename Service>
+void measure_all(string_view name) {
+  constexpr size_t CYCLES = 20000;
+  for (auto observers:BENCHMARK_OBSERVERS) {
+    BenchmarkResult result;
+    {
+      DiscardConsole discard;
+      result = measure<Service, ConsoleLogger>(observers, CYCLES, [](size_t) {
+        return make_unique<ConsoleLogger>();
+      });
+    }
+    print_result(name, "console", observers, result);
+  }
+
+  for (auto observers:BENCHMARK_OBSERVERS) {
+    vector<string> paths;
+    for (size_t i = 0; i < observers; ++i)
+      paths.push_back(tmpfs_path("benchmark_push." + to_string(i) + ".log"));
+    const auto result = measure<Service, FileLogger>(
+      observers, CYCLES, [&](size_t i) {
+        return make_unique<FileLogger>(paths[i]);
+      });
+    print_result(name, "file", observers, result);
+    for (auto& path:paths) ::unlink(path.c_str());
+  }
+}
+
+int main() {
+  measure_all<LoggingService<>>("push");
+  // Latency here is the cost to the caller, while msgs/s waits until the
+  // flusher delivered every message
+  measure_all<AsyncLoggingService<>>("push-async");
+  return 0;
+}
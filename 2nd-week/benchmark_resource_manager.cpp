@@ -0,0 +1,89 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+
+#include "message.hpp"
+#include "message_arena.hpp"
+#include "resource_manager.hpp"
+
+using namespace std;
+
+// Measures notify-style iteration (sample and format every resource)
+// over the ResourceManager, with and without a writer churning entries.
+struct Result {
+  double cycles_per_second;
+  double updates_per_second;
+};
+
+Result run(ResourceManager<IMessage>& resource_manager,
+           vector<string>& churn_names,
+           IMessage& churn_resource,
+           bool churn,
+           chrono::milliseconds duration) {
+  atomic<bool> running {true};
+  atomic<size_t> updates {0};
+  thread writer;
+  if (churn) {
+    writer = thread([&] {
+      while (running.load(memory_order_relaxed)) {
+        for (auto& name:churn_names) resource_manager.add(name, churn_resource);
+        for (auto& name:churn_names) resource_manager.erase(name);
+        updates.fetch_add(2 * churn_names.size(), memory_order_relaxed);
+      }
+    });
+  }
+
+  MessageArena arena;
+  size_t cycles = 0;
+  const auto begin = chrono::steady_clock::now();
+  auto now = begin;
+  while (now - begin < duration) {
+    arena.clear();
+    for (auto& [name, entry]:resource_manager.snapshot()) {
+      char* buf = arena.prepare(IMessage::MAX_FORMATTED);
+      arena.commit(entry.resource->format_to(buf, entry.resource->sample()));
+    }
+    ++cycles;
+    now = chrono::steady_clock::now();
+  }
+  running.store(false);
+  if (writer.joinable()) writer.join();
+
+  const double seconds = chrono::duration<double>(now - begin).count();
+  return Result{cycles / seconds, updates.load() / seconds};
+}
+
+int main() {
+  constexpr size_t RESOURCES = 256;
+  constexpr size_t CHURN = 16;
+  const auto duration = chrono::milliseconds(1000);
+
+  vector<CpuUtilizationMessage> messages(RESOURCES);
+  vector<string> names;
+  for (size_t i = 0; i < RESOURCES; ++i)
+    names.push_back("resource-" + to_string(i));
+  vector<string> churn_names;
+  for (size_t i = 0; i < CHURN; ++i)
+    churn_names.push_back("churn-" + to_string(i));
+  CpuUtilizationMessage churn_resource;
+
+  ResourceManager<IMessage> resource_manager;
+  for (size_t i = 0; i < RESOURCES; ++i)
+    resource_manager.add(names[i], messages[i]);
+
+  const auto idle = run(resource_manager, churn_names, churn_resource,
+                        false, duration);
+  const auto busy = run(resource_manager, churn_names, churn_resource,
+                        true, duration);
+
+  cout << RESOURCES << " resources, " << thread::hardware_concurrency()
+       << " hardware threads" << endl;
+  cout << "notify without churn: " << idle.cycles_per_second
+       << " cycles/s" << endl;
+  cout << "notify with churn:    " << busy.cycles_per_second
+       << " cycles/s, " << busy.updates_per_second << " updates/s" << endl;
+  return 0;
+}
@@ -0,0 +1,108 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "generator.hpp"
+#include "rule_engine.hpp"
+
+using namespace std;
+
+// Thousands of threshold rules over a few resources, evaluated by the
+// columnar RuleEngine and by a loop of virtual calls per rule.
+struct IRule {
+  virtual ~IRule() = default;
+  virtual bool check(const Sample& sample) = 0;
+};
+
+class ThresholdRule : public IRule {
+  const AlertRule rule;
+  uint32_t streak = 0;
+  bool firing = false;
+
+public:
+  ThresholdRule(const AlertRule& rule)
+    : rule(rule) {
+  }
+
+  virtual bool check(const Sample& sample) override {
+    if (sample.resource_id != rule.resource_id) return false;
+    const double v = sample.value.as_double();
+    const bool above = rule.comparison == Comparison::Above;
+    if (firing) {
+      // Same hysteresis as RuleEngine
+      const double clear = std::isnan(rule.clear_at)
+        ? rule.threshold : rule.clear_at;
+      firing = above ? v > clear : v < clear;
+      return !firing;
+    }
+    const bool beyond = above ? v > rule.threshold : v < rule.threshold;
+    streak = beyond ? streak + 1 : 0;
+    firing = streak >= rule.samples;
+    if (firing) streak = 0;
+    return firing;
+  }
+};
+
+int main() {
+  constexpr size_t RULES = 4096;
+  constexpr size_t RESOURCES = 4;
+  constexpr size_t SAMPLES = 200000;
+
+  RandomFloatingGenerator<double, Xoshiro256StarStar> threshold(0, 100, 3);
+  RandomNumericGenerator<int, Xoshiro256StarStar> samples(1, 5, 5);
+  vector<AlertRule> rules;
+  for (size_t i = 0; i < RULES; ++i) {
+    // Every other rule clears 2 units back from its threshold
+    const bool above = i % 2;
+    const double limit = threshold.get();
+    const double clear_at = i % 4 < 2
+      ? limit : (above ? limit - 2 : limit + 2);
+    rules.push_back(AlertRule{"rule " + to_string(i),
+                              static_cast<uint32_t>(i % RESOURCES),
+                              above ? Comparison::Above : Comparison::Below,
+                              limit,
+                              static_cast<uint32_t>(samples.get()),
+                              clear_at});
+  }
+
+  // Values drift like real readings, so alerts change state now and then
+  RandomFloatingGenerator<double, Xoshiro256StarStar> step(-0.5, 0.5, 7);
+  vector<double> level(RESOURCES, 50);
+  vector<Sample> batch(SAMPLES);
+  for (size_t i = 0; i < SAMPLES; ++i) {
+    double& v = level[i % RESOURCES];
+    v = min(100.0, max(0.0, v + step.get()));
+    batch[i] = Sample{i, static_cast<uint32_t>(i % RESOURCES), Value(v)};
+  }
+
+  RuleEngine engine(rules);
+  size_t engine_events = 0;
+  auto begin = chrono::steady_clock::now();
+  for (auto& sample:batch)
+    engine.evaluate(sample, [&](const AlertEvent&) { ++engine_events; });
+  const double columnar = chrono::duration<double, nano>(
+    chrono::steady_clock::now() - begin).count() / SAMPLES;
+
+  vector<unique_ptr<IRule>> virtual_rules;
+  for (auto& rule:rules) virtual_rules.push_back(make_unique<ThresholdRule>(rule));
+  size_t virtual_events = 0;
+  begin = chrono::steady_clock::now();
+  for (auto& sample:batch)
+    for (auto& rule:virtual_rules) virtual_events += rule->check(sample);
+  const double per_rule = chrono::duration<double, nano>(
+    chrono::steady_clock::now() - begin).count() / SAMPLES;
+
+  cout << RULES << " rules over " << RESOURCES << " resources" << fixed
+       << setprecision(1) << endl
+       << "RuleEngine:    " << setw(8) << columnar << " ns/sample, "
+       << engine_events << " events" << endl
+       << "virtual calls: " << setw(8) << per_rule << " ns/sample, "
+       << virtual_events << " events"
+       << defaultfloat << setprecision(6) << endl;
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string_view>
+#include <sstream>
+
+#include "message.hpp"
+#include "message_arena.hpp"
+
+using namespace std;
+
+// CPU cost per sample of the random and the /proc based samplers
+template <typename T>
+void measure(string_view name, IResourceUtilization<T>& resource,
+             size_t count) {
+  volatile double sink = 0;
+  const auto begin = chrono::steady_clock::now();
+  for (size_t i = 0; i < count; ++i)
+    sink = sink + resource.get();
+  const auto elapsed = chrono::steady_clock::now() - begin;
+  const double ns = chrono::duration<double, nano>(elapsed).count() / count;
+  cout << left << setw(24) << name << right << setw(10) << fixed
+       << setprecision(1) << ns << " ns/sample, "
+       << setw(10) << setprecision(1) << 1e6 / ns << " kHz on one core ("
+       << defaultfloat << setprecision(6) << resource.get() << " " << resource.unit() << ")"
+       << endl;
+}
+
+// Cost per message of formatting through a stream and through format_to()
+void measure_format(string_view name, IMessage& message, size_t count) {
+  const Value value = message.sample();
+  MessageArena arena;
+  const auto stream_begin = chrono::steady_clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    if (arena.size() == 1024) arena.clear();
+    ostringstream text;
+    text << message.label() << ": " << value << " " << message.unit() << endl;
+    arena.stream() << text.str();
+    arena.commit();
+  }
+  const auto stream_elapsed = chrono::steady_clock::now() - stream_begin;
+
+  arena.clear();
+  const auto direct_begin = chrono::steady_clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    if (arena.size() == 1024) arena.clear();
+    char* buf = arena.prepare(IMessage::MAX_FORMATTED);
+    arena.commit(message.format_to(buf, value));
+  }
+  const auto direct_elapsed = chrono::steady_clock::now() - direct_begin;
+
+  cout << left << setw(24) << name << right << fixed << setprecision(1)
+       << setw(10) << chrono::duration<double, nano>(stream_elapsed).count() / count
+       << " ns/message with ostringstream, "
+       << setw(6) << chrono::duration<double, nano>(direct_elapsed).count() / count
+       << " ns/message with format_to ("
+       << arena[0].substr(0, arena[0].size() - 1) << ")"
+       << defaultfloat << setprecision(6) << endl;
+}
+
+// Cost per call of the ways to time-stamp a sample
+template <typename F>
+void measure_clock(string_view name, size_t count, F&& read) {
+  volatile uint64_t sink = 0;
+  const auto begin = chrono::steady_clock::now();
+  for (size_t i = 0; i < count; ++i)
+    sink = sink + read();
+  const auto elapsed = chrono::steady_clock::now() - begin;
+  cout << left << setw(24) << name << right << setw(10) << fixed
+       << setprecision(1)
+       << chrono::duration<double, nano>(elapsed).count() / count
+       << " ns/timestamp" << defaultfloat << setprecision(6) << endl;
+}
+
+int main() {
+  constexpr size_t COUNT = 20000;
+
+  CpuUtilization<> cpu;
+  DiskUtilization<> disk;
+  MemoryUtilization<> memory;
+  NetworkUtilization<> network;
+  measure("CpuUtilization", cpu, COUNT);
+  measure("DiskUtilization", disk, COUNT);
+  measure("MemoryUtilization", memory, COUNT);
+  measure("NetworkUtilization", network, COUNT);
+
+  ProcCpuUtilization<> proc_cpu;
+  ProcDiskUtilization<> proc_disk;
+  ProcMemoryUtilization<> proc_memory;
+  ProcNetworkUtilization<> proc_network;
+  measure("ProcCpuUtilization", proc_cpu, COUNT);
+  measure("ProcDiskUtilization", proc_disk, COUNT);
+  measure("ProcMemoryUtilization", proc_memory, COUNT);
+  measure("ProcNetworkUtilization", proc_network, COUNT);
+
+  CpuUtilizationMessage cpu_message;
+  MemoryUtilizationMessage memory_message;
+  measure_format("CpuUtilizationMessage", cpu_message, COUNT * 10);
+  measure_format("MemoryUtilizationMessage", memory_message, COUNT * 10);
+
+  TscClock& clock = TscClock::instance();
+  cout << "TscClock reads " << (clock.uses_tsc() ? "the TSC" : "clock_gettime")
+       << ", " << clock.ns_per_tick() << " ns/tick" << endl;
+  measure_clock("system_clock::now", COUNT * 10, [] {
+    return chrono::system_clock::now().time_since_epoch().count();
+  });
+  measure_clock("sample_ticks", COUNT * 10, [] { return sample_ticks(); });
+  measure_clock("ticks_to_timestamp", COUNT * 10, [] {
+    return ticks_to_timestamp(sample_ticks());
+  });
+  return 0;
+}
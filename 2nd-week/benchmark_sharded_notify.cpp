@@ -0,0 +1,78 @@
+#include "2_apply_observer_pattern_using_push_model.cpp"
+#include "benchmark.hpp"
+
+// Cheap synthetic resource, so that 100k of them fit in memory and the
+// cycle measures the service rather than the random number generators
+class CounterMessage : public IMessage {
+  int64_t count = 0;
+
+public:
+  virtual ~CounterMessage() = default;
+
+  virtual ostream& operator<<(ostream& o) override {
+    return format(o, *this, sample());
+  }
+
+  virtual string_view label() const override {
+    return "Counter";
+  }
+
+  virtual string_view unit() const override {
+    return "events";
+  }
+
+  virtual Value sample() override {
+    return Value(++count);
+  }
+};
+
+// Sums what it is given, standing in for a sink without I/O
+class CountingLogger : public ILogger {
+public:
+  size_t bytes = 0;
+
+  virtual ~CountingLogger() = default;
+
+  virtual void write(string_view msg) override {
+    bytes += msg.size();
+  }
+};
+
+int main() {
+  constexpr size_t RESOURCES = 100000;
+  constexpr size_t OBSERVERS = 8;
+  constexpr size_t CYCLES = 20;
+  const size_t THREADS[] = {1, 2, 4, 8, 16, 32, 64};
+
+  vector<CounterMessage> messages(RESOURCES);
+  vector<string> names;
+  for (size_t i = 0; i < RESOURCES; ++i)
+    names.push_back("host-" + to_string(i / 16) + ".metric-"
+                    + to_string(i % 16));
+
+  cout << RESOURCES << " resources, " << OBSERVERS << " observers, "
+       << thread::hardware_concurrency() << " hardware threads" << endl;
+  double baseline = 0;
+  for (auto threads:THREADS) {
+    // A few shards per thread keeps the workers busy when shards differ
+    ShardedResourceManager<IMessage> resource_manager(threads * 4);
+    for (size_t i = 0; i < RESOURCES; ++i)
+      resource_manager.add(names[i], messages[i]);
+    vector<CountingLogger> loggers(OBSERVERS);
+
+    WorkerPool pool(threads);
+    ShardedLoggingService<> logging_service(resource_manager, pool);
+    for (auto& logger:loggers) logging_service.subscribe(logger);
+    const auto result = run_benchmark(CYCLES, RESOURCES, [&] {
+      logging_service.notify();
+    });
+    if (threads == 1) baseline = result.messages_per_second;
+
+    cout << setw(2) << threads << " threads: " << fixed << setprecision(0)
+         << setw(10) << result.messages_per_second << " msgs/s, p50 "
+         << setw(6) << result.p50 / 1e3 << " us per cycle, speedup "
+         << setprecision(2) << result.messages_per_second / baseline
+         << defaultfloat << setprecision(6) << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <string_view>
+
+#include <sched.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "shm_ring.hpp"
+#include "streaming_stats.hpp"
+
+using namespace std;
+
+constexpr uint32_t LAST = UINT32_MAX;
+
+// Child process: reads until the last record, reporting end-to-end
+// latency from the sample timestamp to the moment the record is seen.
+int read_ring(string_view name) {
+  ShmRingReader reader(name, true);
+  LogHistogram latency;
+  ShmRecord record;
+  size_t received = 0;
+  for (;;) {
+    if (!reader.poll(record)) {
+      sched_yield();
+      continue;
+    }
+    if (record.resource_id == LAST) break;
+    latency.record(static_cast<double>(sample_timestamp() - record.timestamp));
+    ++received;
+  }
+  cout << "reader: received " << received << ", lost " << reader.lost()
+       << fixed << setprecision(0)
+       << ", latency p50 " << latency.percentile(0.5)
+       << " ns, p99 " << latency.percentile(0.99)
+       << " ns, max " << latency.max() << " ns"
+       << defaultfloat << setprecision(6) << endl;
+  return 0;
+}
+
+void measure(string_view name, size_t count, size_t burst,
+             chrono::microseconds pause) {
+  ShmRingWriter writer(name);
+  const pid_t pid = fork();
+  if (pid == 0) _exit(read_ring(name));
+
+  const string_view text = "CPU: 42 %\n";
+  chrono::nanoseconds busy {0};
+  for (size_t i = 0; i < count; i += burst) {
+    const auto begin = chrono::steady_clock::now();
+    for (size_t j = 0; j < burst; ++j) {
+      Sample sample {sample_timestamp(), static_cast<uint32_t>(j % 4),
+                     Value(static_cast<int>(i + j))};
+      writer.publish(sample, text);
+    }
+    busy += chrono::steady_clock::now() - begin;
+    this_thread::sleep_for(pause);
+  }
+  writer.publish(Sample{sample_timestamp(), LAST, Value(0)}, ""sv);
+
+  int status;
+  waitpid(pid, &status, 0);
+  cout << "writer: burst " << burst << ", " << fixed << setprecision(1)
+       << chrono::duration<double, nano>(busy).count() / count
+       << " ns/record" << defaultfloat << setprecision(6) << endl;
+}
+
+int main() {
+  constexpr size_t COUNT = 200000;
+  measure("/benchmark-shm-ring", COUNT / 10, 1, chrono::microseconds(20));
+  measure("/benchmark-shm-ring", COUNT, 64, chrono::microseconds(100));
+  measure("/benchmark-shm-ring", COUNT, 8192, chrono::microseconds(1000));
+  return 0;
+}
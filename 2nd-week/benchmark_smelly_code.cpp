@@ -0,0 +1,18 @@
+#include "1_smelly_code.cpp"
+#include "benchmark.hpp"
+
+// ResourceMonitor has its two sinks built in: the console and one file
+int main() {
+  constexpr size_t CYCLES = 20000;
+
+  const string path = tmpfs_path("benchmark_smelly.log");
+  BenchmarkResult result;
+  {
+    DiscardConsole discard;
+    ResourceMonitor monitor(path);
+    result = run_benchmark(CYCLES, 4, [&] { monitor.update(); });
+  }
+  print_result("smelly", "both", 2, result);
+  ::unlink(path.c_str());
+  return 0;
+}
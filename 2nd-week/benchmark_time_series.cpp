@@ -0,0 +1,67 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+
+#include "generator.hpp"
+#include "time_series.hpp"
+
+using namespace std;
+
+// One hour of 1 kHz samples with scheduler-like jitter for two series:
+// an integer percentage and a memory size in GB derived from kB counts,
+// as the /proc samplers produce them. Reports bytes per point, append
+// cost and query speed.
+int main() {
+  constexpr uint64_t POINTS = 3600 * 1000;
+  constexpr uint64_t PERIOD = 1000000;   // 1 ms in ns
+  using Clock = chrono::steady_clock;
+
+  RandomNumericGenerator<int, Xoshiro256StarStar> jitter(-20000, 20000, 7);
+  RandomNumericGenerator<int, Xoshiro256StarStar> step(-1, 1, 11);
+  RandomNumericGenerator<int, Xoshiro256StarStar> kb(-4096, 4096, 13);
+
+  TimeSeriesStore store;
+  const uint64_t origin = 1700000000ull * 1000000000ull;
+  int cpu = 50;
+  int64_t memory_kb = 8 << 20;
+  const auto begin = Clock::now();
+  for (uint64_t i = 0; i < POINTS; ++i) {
+    const uint64_t timestamp = origin + i * PERIOD + jitter.get();
+    cpu = min(100, max(0, cpu + step.get()));
+    memory_kb += kb.get();
+    store.append(0, timestamp, cpu);
+    store.append(1, timestamp, static_cast<double>(memory_kb) / (1 << 20));
+  }
+  const double append = chrono::duration<double, nano>(
+    Clock::now() - begin).count() / (2 * POINTS);
+
+  const size_t bytes = store.memory_bytes();
+  cout << fixed << setprecision(2) << store.points() << " points, "
+       << bytes << " bytes, " << double(bytes) / store.points()
+       << " bytes/point (16 raw), " << append << " ns/append" << endl;
+
+  const uint64_t end = origin + POINTS * PERIOD;
+  uint64_t scanned = 0;
+  auto t0 = Clock::now();
+  store.scan(1, origin, end, [&](uint64_t, double) { ++scanned; });
+  const double scan = chrono::duration<double>(Clock::now() - t0).count();
+  cout << "scan: " << scanned / scan / 1e6 << " M points/s" << endl;
+
+  t0 = Clock::now();
+  const auto minutes = store.downsample(0, origin, end, 60 * 1000 * PERIOD);
+  const double minute = chrono::duration<double, milli>(
+    Clock::now() - t0).count();
+  t0 = Clock::now();
+  const auto range = store.downsample(0, origin + 600 * 1000 * PERIOD,
+                                      origin + 610 * 1000 * PERIOD,
+                                      1000 * PERIOD);
+  const double ten = chrono::duration<double, milli>(
+    Clock::now() - t0).count();
+  cout << "downsample 1 h to " << minutes.size() << " minutes: " << minute
+       << " ms, 10 s to " << range.size() << " seconds: " << ten << " ms"
+       << endl;
+  cout << "first minute: count " << minutes[0].count << ", mean "
+       << minutes[0].mean << ", min " << minutes[0].min << ", max "
+       << minutes[0].max << defaultfloat << setprecision(6) << endl;
+  return 0;
+}
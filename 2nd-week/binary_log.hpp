@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sample.hpp"
+
+// Layout of a binary resource log:
+//   BinaryLogHeader
+//   entry_count x { uint32 id, uint16 label size, uint16 unit size,
+//                   label bytes, unit bytes }
+//   BinaryLogRecord...
+// All integers are stored in host byte order.
+struct BinaryLogHeader {
+  static constexpr char MAGIC[4] = {'R', 'S', 'L', 'G'};
+  static constexpr uint16_t VERSION = 1;
+
+  char magic[4];
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t entry_count;
+};
+static_assert(sizeof(BinaryLogHeader) == 12);
+
+struct BinaryLogRecord {
+  uint64_t timestamp;
+  uint32_t resource_id;
+  uint8_t type;
+  uint8_t reserved[3];
+  uint64_t bits;   // the int64_t or double, as Value::bits()
+
+  BinaryLogRecord() = default;
+
+  BinaryLogRecord(const Sample& sample)
+    : timestamp(sample.timestamp), resource_id(sample.resource_id),
+      type(static_cast<uint8_t>(sample.value.type)), reserved{},
+      bits(sample.value.bits()) {
+  }
+
+  Value value() const {
+    return Value::from_bits(static_cast<ValueType>(type), bits);
+  }
+};
+static_assert(sizeof(BinaryLogRecord) == 24);
+
+struct BinaryLogEntry {
+  uint32_t id;
+  std::string label;
+  std::string unit;
+};
+
+inline void write_binary_log_header(
+  std::ostream& o, const std::vector<BinaryLogEntry>& entries) {
+  BinaryLogHeader header;
+  std::memcpy(header.magic, BinaryLogHeader::MAGIC, sizeof(header.magic));
+  header.version = BinaryLogHeader::VERSION;
+  header.record_size = sizeof(BinaryLogRecord);
+  header.entry_count = static_cast<uint32_t>(entries.size());
+  o.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (auto& entry:entries) {
+    const uint16_t label_size = static_cast<uint16_t>(entry.label.size());
+    const uint16_t unit_size = static_cast<uint16_t>(entry.unit.size());
+    o.write(reinterpret_cast<const char*>(&entry.id), sizeof(entry.id));
+    o.write(reinterpret_cast<const char*>(&label_size), sizeof(label_size));
+    o.write(reinterpret_cast<const char*>(&unit_size), sizeof(unit_size));
+    o.write(entry.label.data(), label_size);
+    o.write(entry.unit.data(), unit_size);
+  }
+}
+
+inline std::vector<BinaryLogEntry> read_binary_log_header(std::istream& in) {
+  BinaryLogHeader header;
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+      || std::memcmp(header.magic, BinaryLogHeader::MAGIC,
+                     sizeof(header.magic)) != 0)
+    throw std::runtime_error("Not a binary resource log");
+  if (header.version != BinaryLogHeader::VERSION
+      || header.record_size != sizeof(BinaryLogRecord))
+    throw std::runtime_error(
+      "Unsupported binary log version " + std::to_string(header.version));
+
+  std::vector<BinaryLogEntry> entries(header.entry_count);
+  for (auto& entry:entries) {
+    uint16_t label_size = 0, unit_size = 0;
+    in.read(reinterpret_cast<char*>(&entry.id), sizeof(entry.id));
+    in.read(reinterpret_cast<char*>(&label_size), sizeof(label_size));
+    in.read(reinterpret_cast<char*>(&unit_size), sizeof(unit_size));
+    entry.label.resize(label_size);
+    entry.unit.resize(unit_size);
+    in.read(entry.label.data(), label_size);
+    in.read(entry.unit.data(), unit_size);
+  }
+  if (!in)
+    throw std::runtime_error("Truncated binary log header");
+  return entries;
+}
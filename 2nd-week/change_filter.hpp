@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "sample.hpp"
+
+// A sample passes when it moves more than max(absolute, relative * |last|)
+// away from the last value that passed, so relative bands work for large
+// values and the absolute one sets a floor near zero. The default band
+// only drops repeats of the same value. A heartbeat lets one sample
+// through after that long without any, so a quiet resource can be told
+// from a dead one.
+struct Deadband {
+  double absolute = 0;
+  double relative = 0;
+  std::chrono::nanoseconds heartbeat {0};
+};
+
+// Per-resource suppression state, indexed by resource id. Resources
+// without a Deadband always pass. NaN counts as a change both ways, so
+// it is written and does not stick as the reference value. Thread-safe;
+// admit() skips the lock until the first set().
+class ChangeFilter {
+  struct State {
+    bool enabled = false;
+    bool emitted = false;
+    Deadband band;
+    double last = 0;
+    uint64_t last_timestamp = 0;
+  };
+
+  mutable std::mutex mtx;
+  std::vector<State> states;
+  std::atomic<bool> configured {false};
+  std::atomic<size_t> passed_count {0};
+  std::atomic<size_t> suppressed_count {0};
+
+public:
+  void set(uint32_t resource_id, const Deadband& band) {
+    std::scoped_lock<std::mutex> lock {mtx};
+    configured.store(true, std::memory_order_release);
+    if (states.size() <= resource_id) states.resize(resource_id + 1);
+    State& state = states[resource_id];
+    state.enabled = true;
+    state.emitted = false;
+    state.band = band;
+  }
+
+  void clear(uint32_t resource_id) {
+    std::scoped_lock<std::mutex> lock {mtx};
+    if (resource_id < states.size()) states[resource_id] = State();
+  }
+
+  // Whether the sample, whose timestamp is in nanoseconds, should be
+  // written; remembers it if so.
+  bool admit(const Sample& sample) {
+    if (!configured.load(std::memory_order_acquire)) {
+      passed_count.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    std::scoped_lock<std::mutex> lock {mtx};
+    if (sample.resource_id >= states.size()
+        || !states[sample.resource_id].enabled) {
+      passed_count.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    State& state = states[sample.resource_id];
+    const double v = sample.value.as_double();
+    const Deadband& band = state.band;
+    const double width = std::max(band.absolute,
+                                  band.relative * std::fabs(state.last));
+    const uint64_t heartbeat = band.heartbeat.count();
+    const bool pass = !state.emitted
+      || std::isnan(v) || std::isnan(state.last)
+      || std::fabs(v - state.last) > width
+      || (heartbeat > 0 && sample.timestamp - state.last_timestamp >= heartbeat);
+    if (!pass) {
+      suppressed_count.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    state.emitted = true;
+    state.last = v;
+    state.last_timestamp = sample.timestamp;
+    passed_count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  size_t passed() const {
+    return passed_count.load(std::memory_order_relaxed);
+  }
+
+  size_t suppressed() const {
+    return suppressed_count.load(std::memory_order_relaxed);
+  }
+};
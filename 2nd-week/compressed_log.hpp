@@ -0,0 +1,329 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "lz_codec.hpp"
+
+// Layout of a compressed log:
+//   CompressedLogHeader
+//   block data, each block compressed on its own with LzCodec, or stored
+//   as is when that does not make it smaller
+//   block_count x CompressedLogBlock (the index)
+//   CompressedLogFooter
+// The index records the time span of every block, so a reader seeks to
+// the blocks covering a range and decompresses only those.
+// All integers are stored in host byte order.
+struct CompressedLogHeader {
+  static constexpr char MAGIC[4] = {'R', 'S', 'L', 'Z'};
+  static constexpr uint16_t VERSION = 1;
+
+  char magic[4];
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t block_size;
+};
+static_assert(sizeof(CompressedLogHeader) == 12);
+
+struct CompressedLogBlock {
+  uint64_t offset;
+  uint32_t stored_size;
+  uint32_t raw_size;       // stored_size == raw_size: not compressed
+  uint64_t first_timestamp;
+  uint64_t last_timestamp;
+};
+static_assert(sizeof(CompressedLogBlock) == 32);
+
+struct CompressedLogFooter {
+  uint64_t index_offset;
+  uint32_t block_count;
+  char magic[4];
+};
+static_assert(sizeof(CompressedLogFooter) == 16);
+
+inline void write_fully(int fd, const void* data, size_t n) {
+  const char* p = static_cast<const char*>(data);
+  while (n > 0) {
+    const ssize_t written = ::write(fd, p, n);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      throw std::runtime_error(std::string("write: ") + std::strerror(errno));
+    }
+    p += written;
+    n -= written;
+  }
+}
+
+// Gathers messages into blocks of about block_size bytes. Full blocks
+// are compressed and written by a background thread; append() only
+// copies, and waits only when max_pending blocks are already queued.
+// A write error on the background thread stops further writes and is
+// rethrown by the next append() or by close().
+class CompressedLogWriter {
+  struct Block {
+    std::string data;
+    uint64_t first_timestamp = 0;
+    uint64_t last_timestamp = 0;
+  };
+
+  const size_t block_size;
+  const size_t max_pending;
+  int fd;
+  uint64_t offset = sizeof(CompressedLogHeader);
+  std::vector<CompressedLogBlock> index;
+
+  Block current;
+  std::deque<Block> pending;
+  std::vector<std::string> spare;
+  bool stopping = false;
+  bool closed = false;
+  std::exception_ptr error;        // guarded by mtx
+  std::atomic<bool> failed {false};
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::thread worker;
+
+  void rethrow() {
+    std::scoped_lock<std::mutex> lock {mtx};
+    std::rethrow_exception(error);
+  }
+
+  void seal() {
+    if (current.data.empty()) return;
+    std::unique_lock<std::mutex> lock {mtx};
+    cv.wait(lock, [this] { return pending.size() < max_pending; });
+    pending.push_back(std::move(current));
+    current = Block();
+    if (!spare.empty()) {
+      current.data.swap(spare.back());
+      spare.pop_back();
+    }
+    current.data.reserve(block_size);
+    cv.notify_all();
+  }
+
+  void store(const Block& block, LzCodec& codec, std::string& compressed) {
+    compressed.clear();
+    codec.compress(block.data, compressed);
+    const bool smaller = compressed.size() < block.data.size();
+    const std::string& stored = smaller ? compressed : block.data;
+    write_fully(fd, stored.data(), stored.size());
+    index.push_back(CompressedLogBlock{
+      offset, static_cast<uint32_t>(stored.size()),
+      static_cast<uint32_t>(block.data.size()),
+      block.first_timestamp, block.last_timestamp});
+    offset += stored.size();
+  }
+
+  void run() {
+    LzCodec codec;
+    std::string compressed;
+    std::unique_lock<std::mutex> lock {mtx};
+    for (;;) {
+      cv.wait(lock, [this] { return stopping || !pending.empty(); });
+      if (pending.empty()) break;
+      Block block = std::move(pending.front());
+      pending.pop_front();
+      cv.notify_all();
+
+      const bool skip = error != nullptr;
+      lock.unlock();
+      std::exception_ptr failure;
+      // Blocks after a failure are dropped, so append() never waits
+      if (!skip) {
+        try {
+          store(block, codec, compressed);
+        } catch (...) {
+          failure = std::current_exception();
+        }
+      }
+      block.data.clear();
+      lock.lock();
+      if (failure) {
+        error = failure;
+        failed.store(true, std::memory_order_release);
+      }
+      spare.push_back(std::move(block.data));
+    }
+  }
+
+public:
+  CompressedLogWriter(std::string_view filename,
+                      size_t block_size = 64 * 1024, size_t max_pending = 4)
+    : block_size(block_size), max_pending(max_pending),
+      fd(::open(std::string(filename).c_str(),
+                O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) {
+    if (block_size == 0 || block_size > UINT32_MAX || max_pending == 0) {
+      if (fd >= 0) ::close(fd);
+      throw std::invalid_argument("Invalid compressed log options");
+    }
+    if (fd < 0)
+      throw std::runtime_error("Cannot open " + std::string(filename)
+                               + ": " + std::strerror(errno));
+    CompressedLogHeader header;
+    std::memcpy(header.magic, CompressedLogHeader::MAGIC, sizeof(header.magic));
+    header.version = CompressedLogHeader::VERSION;
+    header.reserved = 0;
+    header.block_size = static_cast<uint32_t>(block_size);
+    try {
+      write_fully(fd, &header, sizeof(header));
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+    current.data.reserve(block_size);
+    worker = std::thread(&CompressedLogWriter::run, this);
+  }
+
+  CompressedLogWriter(const CompressedLogWriter&) = delete;
+  CompressedLogWriter& operator=(const CompressedLogWriter&) = delete;
+
+  // Errors are lost here; call close() to see them.
+  virtual ~CompressedLogWriter() {
+    try {
+      close();
+    } catch (const std::exception&) {
+      // Nothing to report to from a destructor
+    }
+  }
+
+  // Writes the last block, the index and the footer, then throws the
+  // first write error, if any. Later calls do nothing.
+  void close() {
+    if (closed) return;
+    closed = true;
+    seal();
+    {
+      std::scoped_lock<std::mutex> lock {mtx};
+      stopping = true;
+      cv.notify_all();
+    }
+    worker.join();
+
+    CompressedLogFooter footer;
+    footer.index_offset = offset;
+    footer.block_count = static_cast<uint32_t>(index.size());
+    std::memcpy(footer.magic, CompressedLogHeader::MAGIC, sizeof(footer.magic));
+    try {
+      if (error) std::rethrow_exception(error);
+      write_fully(fd, index.data(), index.size() * sizeof(CompressedLogBlock));
+      write_fully(fd, &footer, sizeof(footer));
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+    ::close(fd);
+  }
+
+  // Not thread-safe; callers serialize, as LoggingService does.
+  void append(uint64_t timestamp, std::string_view msg) {
+    if (failed.load(std::memory_order_acquire)) rethrow();
+    if (closed) throw std::logic_error("Compressed log is closed");
+    if (!current.data.empty()
+        && current.data.size() + msg.size() > block_size)
+      seal();
+    if (current.data.empty()) current.first_timestamp = timestamp;
+    current.last_timestamp = timestamp;
+    current.data.append(msg);
+  }
+};
+
+class CompressedLogReader {
+  int fd;
+  std::vector<CompressedLogBlock> index;
+
+  void read_at(void* data, size_t n, uint64_t offset) const {
+    char* p = static_cast<char*>(data);
+    while (n > 0) {
+      const ssize_t got = ::pread(fd, p, n, offset);
+      if (got < 0 && errno == EINTR) continue;
+      if (got <= 0) throw std::runtime_error("Truncated compressed log");
+      p += got;
+      n -= got;
+      offset += got;
+    }
+  }
+
+public:
+  CompressedLogReader(std::string_view filename)
+    : fd(::open(std::string(filename).c_str(), O_RDONLY | O_CLOEXEC)) {
+    if (fd < 0)
+      throw std::runtime_error("Cannot open " + std::string(filename)
+                               + ": " + std::strerror(errno));
+    try {
+      CompressedLogHeader header;
+      read_at(&header, sizeof(header), 0);
+      if (std::memcmp(header.magic, CompressedLogHeader::MAGIC,
+                      sizeof(header.magic)) != 0)
+        throw std::runtime_error("Not a compressed resource log");
+      if (header.version != CompressedLogHeader::VERSION)
+        throw std::runtime_error(
+          "Unsupported compressed log version "
+          + std::to_string(header.version));
+
+      struct stat st;
+      if (::fstat(fd, &st) < 0
+          || size_t(st.st_size) < sizeof(header) + sizeof(CompressedLogFooter))
+        throw std::runtime_error("Compressed log has no index");
+      CompressedLogFooter footer;
+      read_at(&footer, sizeof(footer), st.st_size - sizeof(footer));
+      if (std::memcmp(footer.magic, CompressedLogHeader::MAGIC,
+                      sizeof(footer.magic)) != 0
+          || footer.index_offset + uint64_t(footer.block_count)
+             * sizeof(CompressedLogBlock) + sizeof(footer) != uint64_t(st.st_size))
+        throw std::runtime_error("Compressed log has no index");
+      index.resize(footer.block_count);
+      read_at(index.data(), index.size() * sizeof(CompressedLogBlock),
+              footer.index_offset);
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+  }
+
+  CompressedLogReader(const CompressedLogReader&) = delete;
+  CompressedLogReader& operator=(const CompressedLogReader&) = delete;
+
+  virtual ~CompressedLogReader() {
+    ::close(fd);
+  }
+
+  const std::vector<CompressedLogBlock>& blocks() const {
+    return index;
+  }
+
+  std::string read_block(size_t i) const {
+    const CompressedLogBlock& block = index.at(i);
+    std::string stored(block.stored_size, '\0');
+    read_at(stored.data(), stored.size(), block.offset);
+    if (block.stored_size == block.raw_size) return stored;
+    return LzCodec::decompress(stored, block.raw_size);
+  }
+
+  // Calls f(text) for every block whose span overlaps [from, to]. Blocks
+  // are in time order, so the scan stops at the first one past the range.
+  template <typename F>
+  void read_range(uint64_t from, uint64_t to, F&& f) const {
+    for (size_t i = 0; i < index.size(); ++i) {
+      if (index[i].first_timestamp > to) break;
+      if (index[i].last_timestamp < from) continue;
+      const std::string text = read_block(i);
+      f(std::string_view(text));
+    }
+  }
+};
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <chrono>
+#include <cstring>
+
+#include "binary_log.hpp"
+
+using namespace std;
+
+// Converts a binary resource log back to the text format of FileLogger.
+// Usage: decode_binary_log <file> [--timestamps]
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] << " <binary log> [--timestamps]" << endl;
+    return 1;
+  }
+  const bool timestamps = argc > 2 && strcmp(argv[2], "--timestamps") == 0;
+
+  ifstream in(argv[1], ios_base::in | ios_base::binary);
+  if (!in.is_open()) {
+    cerr << "Cannot open " << argv[1] << endl;
+    return 1;
+  }
+
+  try {
+    const auto begin = chrono::steady_clock::now();
+    unordered_map<uint32_t, BinaryLogEntry> dictionary;
+    for (auto& entry:read_binary_log_header(in))
+      dictionary[entry.id] = entry;
+    const size_t header_bytes = in.tellg();
+
+    // Records go out one line at a time, so memory stays constant
+    ostringstream line;
+    size_t count = 0;
+    size_t text_bytes = 0;
+    BinaryLogRecord record;
+    while (in.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+      line.str("");
+      if (timestamps) line << record.timestamp << " ";
+      auto itr = dictionary.find(record.resource_id);
+      if (itr != dictionary.end())
+        line << itr->second.label << ": " << record.value()
+             << " " << itr->second.unit << '\n';
+      else
+        line << "Resource #" << record.resource_id << ": "
+             << record.value() << '\n';
+      const string text = line.str();
+      cout << text;
+      text_bytes += text.size();
+      ++count;
+    }
+    const auto elapsed = chrono::steady_clock::now() - begin;
+
+    const size_t binary_bytes = header_bytes + count * sizeof(record);
+    cerr << count << " records, "
+         << binary_bytes << " binary bytes, "
+         << text_bytes << " text bytes";
+    if (count > 0) {
+      cerr << ", " << double(binary_bytes) / count << " vs "
+           << double(text_bytes) / count << " bytes/sample, "
+           << chrono::duration<double, nano>(elapsed).count() / count
+           << " ns/record to decode and write";
+    }
+    cerr << endl;
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,48 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+
+#include "compressed_log.hpp"
+
+using namespace std;
+
+// Prints the text of a compressed resource log, or only the blocks
+// overlapping a time range given in nanoseconds since the Unix epoch.
+// Usage: decode_compressed_log <file> [<from> <to>]
+int main(int argc, char* argv[]) {
+  if (argc != 2 && argc != 4) {
+    cerr << "Usage: " << argv[0] << " <compressed log> [<from> <to>]" << endl;
+    return 1;
+  }
+  const uint64_t from = argc == 4 ? strtoull(argv[2], nullptr, 10) : 0;
+  const uint64_t to = argc == 4 ? strtoull(argv[3], nullptr, 10) : UINT64_MAX;
+
+  try {
+    const auto begin = chrono::steady_clock::now();
+    CompressedLogReader reader(argv[1]);
+    size_t blocks = 0, stored = 0, raw = 0;
+    for (auto& block:reader.blocks()) {
+      if (block.first_timestamp > to || block.last_timestamp < from) continue;
+      ++blocks;
+      stored += block.stored_size;
+      raw += block.raw_size;
+    }
+    reader.read_range(from, to, [](string_view text) {
+      cout << text;
+    });
+    const auto elapsed = chrono::steady_clock::now() - begin;
+
+    cerr << blocks << " of " << reader.blocks().size() << " blocks, "
+         << stored << " stored bytes, " << raw << " text bytes";
+    if (stored > 0) {
+      cerr << ", ratio " << double(raw) / stored << ", "
+           << raw / chrono::duration<double>(elapsed).count() / 1e6
+           << " MB/s to decode";
+    }
+    cerr << endl;
+  } catch (const exception& e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -1,13 +1,33 @@
+#pragma once
+
+#include <condition_variable>
 #include <fstream>
+#include <iostream>
+#include <mutex>
 #include <string_view>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
 
 // RAII for file descriptor
 class FileHandler {
   std::ofstream out_file;
 
 public:
-  FileHandler(std::string_view out_filename)
-    : out_file(out_filename.data()) {
+  FileHandler(std::string_view out_filename,
+              std::ios_base::openmode mode = std::ios_base::out)
+    : out_file(out_filename.data(), mode) {
   }
 
   virtual ~FileHandler() {
@@ -26,3 +46,197 @@ public:
     return out_file;
   }
 };
+
+enum class Durability {
+  None,
+  SyncPerBatch,
+  SyncPerInterval
+};
+
+struct BatchOptions {
+  size_t batch_bytes = 1 << 20;
+  std::chrono::milliseconds max_delay {100};
+  Durability durability = Durability::None;
+  std::chrono::milliseconds sync_interval {1000};
+};
+
+// Group commit: records gather in a large buffer and reach the kernel in
+// one writev() once batch_bytes are pending or the oldest pending record
+// is older than max_delay. A timer thread enforces max_delay and
+// sync_interval when appends stop coming. append() and flush() throw
+// write errors; the timer thread and the destructor keep the first one
+// for error(), and the destructor reports it.
+class BatchFileHandler {
+  using Clock = std::chrono::steady_clock;
+  static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+  int fd;
+  const BatchOptions options;
+  std::vector<std::unique_ptr<char[]>> chunks;
+  size_t written = 0;   // bytes of the chunks already written
+  size_t pending = 0;   // bytes of the chunks in use
+  Clock::time_point first_pending;
+  Clock::time_point last_sync;
+  bool unsynced = false;
+
+  mutable std::mutex mtx;
+  std::condition_variable cv;
+  bool stopping = false;
+  bool stalled = false;   // the timer failed; retry after the next append
+  std::string first_error;
+  std::thread timer;
+
+  [[noreturn]] static void fail(const char* what) {
+    throw std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+  }
+
+  void keep_error(const char* what) {
+    if (first_error.empty()) first_error = what;
+  }
+
+  // Writes from where the last attempt stopped, so bytes that reached
+  // the file before a failure are never written twice.
+  void write_pending() {
+    while (written < pending) {
+      iovec iov[IOV_MAX];
+      int count = 0;
+      for (size_t at = written; at < pending && count < IOV_MAX; ++count) {
+        const size_t offset = at % CHUNK_SIZE;
+        const size_t n = std::min(CHUNK_SIZE - offset, pending - at);
+        iov[count].iov_base = chunks[at / CHUNK_SIZE].get() + offset;
+        iov[count].iov_len = n;
+        at += n;
+      }
+      const ssize_t n = ::writev(fd, iov, count);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        fail("writev");
+      }
+      written += n;
+      unsynced = true;
+    }
+    written = pending = 0;
+  }
+
+  void sync() {
+    if (::fdatasync(fd) < 0) fail("fdatasync");
+    last_sync = Clock::now();
+    unsynced = false;
+  }
+
+  void copy(const char* data, size_t size) {
+    while (size > 0) {
+      const size_t index = pending / CHUNK_SIZE;
+      const size_t offset = pending % CHUNK_SIZE;
+      if (index == chunks.size())
+        chunks.emplace_back(new char[CHUNK_SIZE]);
+      const size_t n = std::min(size, CHUNK_SIZE - offset);
+      std::memcpy(chunks[index].get() + offset, data, n);
+      data += n;
+      size -= n;
+      pending += n;
+    }
+  }
+
+  void flush_locked() {
+    write_pending();
+    if (!unsynced) return;
+    switch (options.durability) {
+    case Durability::None:
+      break;
+    case Durability::SyncPerBatch:
+      sync();
+      break;
+    case Durability::SyncPerInterval:
+      if (Clock::now() - last_sync >= options.sync_interval) sync();
+      break;
+    }
+  }
+
+  // When the timer must next flush, or max() if nothing is due
+  Clock::time_point deadline() const {
+    auto due = Clock::time_point::max();
+    if (stalled) return due;
+    if (pending > 0) due = first_pending + options.max_delay;
+    if (unsynced && options.durability == Durability::SyncPerInterval)
+      due = std::min(due, last_sync + options.sync_interval);
+    return due;
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock {mtx};
+    while (!stopping) {
+      const auto due = deadline();
+      if (due == Clock::time_point::max()) {
+        cv.wait(lock);
+        continue;
+      }
+      if (Clock::now() < due) {
+        cv.wait_until(lock, due);
+        continue;
+      }
+      try {
+        flush_locked();
+      } catch (const std::exception& e) {
+        keep_error(e.what());
+        stalled = true;
+      }
+    }
+  }
+
+public:
+  BatchFileHandler(std::string_view out_filename,
+                   const BatchOptions& options = BatchOptions())
+    : fd(::open(std::string(out_filename).c_str(),
+                O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)),
+      options(options), last_sync(Clock::now()) {
+    if (fd < 0) fail("open");
+    timer = std::thread(&BatchFileHandler::run, this);
+  }
+
+  BatchFileHandler(const BatchFileHandler&) = delete;
+  BatchFileHandler& operator=(const BatchFileHandler&) = delete;
+
+  virtual ~BatchFileHandler() {
+    {
+      std::scoped_lock<std::mutex> lock {mtx};
+      stopping = true;
+    }
+    cv.notify_all();
+    timer.join();
+    try {
+      write_pending();
+      if (unsynced && options.durability != Durability::None) sync();
+    } catch (const std::exception& e) {
+      keep_error(e.what());
+    }
+    ::close(fd);
+    if (!first_error.empty())
+      std::cerr << "BatchFileHandler: " << first_error << std::endl;
+  }
+
+  void append(std::string_view msg) {
+    std::scoped_lock<std::mutex> lock {mtx};
+    const bool was_empty = pending == 0;
+    if (was_empty) first_pending = Clock::now();
+    copy(msg.data(), msg.size());
+    stalled = false;
+    // A new deadline for the timer: max_delay, or the next sync
+    if (was_empty) cv.notify_one();
+    if (pending >= options.batch_bytes
+        || Clock::now() - first_pending >= options.max_delay)
+      flush_locked();
+  }
+
+  void flush() {
+    std::scoped_lock<std::mutex> lock {mtx};
+    flush_locked();
+  }
+
+  // The first error seen by the timer thread or the destructor, empty
+  // if none
+  std::string error() const {
+    std::scoped_lock<std::mutex> lock {mtx};
+    return first_error;
+  }
+};
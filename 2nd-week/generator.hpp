@@ -1,67 +1,387 @@
+#pragma once
+
 #include <iostream>
 #include <random>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+// Small-state engines; all of them model UniformRandomBitGenerator,
+// so they also work with the standard distributions. Engines with a
+// split(stream_id) member hand out independent, reproducible streams,
+// e.g. one per worker thread.
+class SplitMix64 {
+  uint64_t state;
+
+public:
+  using result_type = uint64_t;
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+
+  explicit SplitMix64(uint64_t seed = 0)
+    : state(seed) {
+  }
+
+  result_type operator()() {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+};
+
+class Xoshiro256StarStar {
+  uint64_t s[4];
+
+  static uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+public:
+  using result_type = uint64_t;
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+
+  explicit Xoshiro256StarStar(uint64_t seed = 0) {
+    SplitMix64 seeder(seed);
+    for (auto& word:s) word = seeder();
+  }
+
+  // Advances by 2^128 values
+  void jump() {
+    static constexpr uint64_t JUMP[] = {
+      0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull,
+      0xa9582618e03fc9aaull, 0x39abdc4529b1661cull
+    };
+    uint64_t t[4] = {};
+    for (auto word:JUMP) {
+      for (int bit = 0; bit < 64; ++bit) {
+        if (word & (uint64_t(1) << bit))
+          for (int i = 0; i < 4; ++i) t[i] ^= s[i];
+        (*this)();
+      }
+    }
+    for (int i = 0; i < 4; ++i) s[i] = t[i];
+  }
+
+  // Each jump costs about 256 steps, so stream ids are bounded
+  static constexpr uint64_t MAX_STREAMS = uint64_t(1) << 16;
+
+  // Stream n starts (n + 1) * 2^128 values after this one, so streams
+  // never overlap each other or the parent.
+  Xoshiro256StarStar split(uint64_t stream_id) const {
+    if (stream_id >= MAX_STREAMS)
+      throw std::invalid_argument("The stream id exceeds MAX_STREAMS");
+    Xoshiro256StarStar stream = *this;
+    for (uint64_t i = 0; i <= stream_id; ++i) stream.jump();
+    return stream;
+  }
+
+  result_type operator()() {
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+  }
+};
+
+// PCG XSL RR 128/64
+class Pcg64 {
+  __uint128_t state;
+  __uint128_t increment;
+
+  static constexpr __uint128_t MULTIPLIER
+    = (__uint128_t(2549297995355413924ull) << 64) | 4865540595714422341ull;
+
+  void step() {
+    state = state * MULTIPLIER + increment;
+  }
+
+public:
+  using result_type = uint64_t;
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+
+  explicit Pcg64(uint64_t seed = 0, uint64_t stream = 0xda3e39cb94b95bdbull)
+    : state(0), increment((__uint128_t(stream) << 1) | 1) {
+    step();
+    state += seed;
+    step();
+  }
+
+  result_type operator()() {
+    step();
+    const uint64_t folded = uint64_t(state >> 64) ^ uint64_t(state);
+    const unsigned rotation = unsigned(state >> 122);
+    return (folded >> rotation) | (folded << ((64 - rotation) & 63));
+  }
+};
+
+// Counter-based Philox4x32-10 (Salmon et al., SC'11). A value is a pure
+// function of (key, stream, index), so a stream can be split off or
+// skipped ahead in O(1) without sharing any state.
+class Philox4x32 {
+  static constexpr uint32_t M0 = 0xd2511f53u;
+  static constexpr uint32_t M1 = 0xcd9e8d57u;
+  static constexpr uint32_t W0 = 0x9e3779b9u;
+  static constexpr uint32_t W1 = 0xbb67ae85u;
+
+  uint32_t key[2];
+  uint64_t stream;
+  uint64_t index = 0;
+  std::array<uint32_t, 4> block {};
+  unsigned used = 4;
+
+  void generate() {
+    block = bijection({uint32_t(index), uint32_t(index >> 32),
+                       uint32_t(stream), uint32_t(stream >> 32)},
+                      key[0], key[1]);
+    ++index;
+    used = 0;
+  }
+
+public:
+  // Ten rounds over one 128-bit counter, as in Random123's philox4x32
+  static constexpr std::array<uint32_t, 4> bijection(
+      std::array<uint32_t, 4> c, uint32_t k0, uint32_t k1) {
+    for (int round = 0; round < 10; ++round) {
+      const uint64_t p0 = uint64_t(M0) * c[0];
+      const uint64_t p1 = uint64_t(M1) * c[2];
+      c = {uint32_t(p1 >> 32) ^ c[1] ^ k0, uint32_t(p1),
+           uint32_t(p0 >> 32) ^ c[3] ^ k1, uint32_t(p0)};
+      k0 += W0;
+      k1 += W1;
+    }
+    return c;
+  }
+
+  using result_type = uint64_t;
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+
+  explicit Philox4x32(uint64_t seed = 0, uint64_t stream = 0)
+    : key{uint32_t(seed), uint32_t(seed >> 32)}, stream(stream) {
+  }
+
+  result_type operator()() {
+    if (used == 4) generate();
+    const uint64_t high = block[used++];
+    return (high << 32) | block[used++];
+  }
+
+  // Skips n values
+  void discard(uint64_t n) {
+    const uint64_t position = index * 2 - (4 - used) / 2 + n;
+    index = position / 2;
+    used = 4;
+    if (position % 2) {
+      generate();
+      used = 2;
+    }
+  }
+
+  // The child's key hashes the parent's key and stream, so a child never
+  // replays its parent, and a.split(1).split(2) differs from a.split(2).
+  Philox4x32 split(uint64_t stream_id) const {
+    const uint64_t seed = uint64_t(key[1]) << 32 | key[0];
+    SplitMix64 mixer(seed ^ SplitMix64(stream)());
+    return Philox4x32(mixer(), stream_id);
+  }
+};
+
+// Known-answer vectors of Random123 (kat_vectors, philox4x32 10 rounds)
+constexpr bool philox_known_answers() {
+  struct Vector {
+    std::array<uint32_t, 4> counter;
+    uint32_t key[2];
+    std::array<uint32_t, 4> expected;
+  };
+  constexpr Vector VECTORS[] = {
+    {{0, 0, 0, 0}, {0, 0},
+     {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}},
+    {{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+     {0xffffffff, 0xffffffff},
+     {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}},
+    {{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+     {0xa4093822, 0x299f31d0},
+     {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}},
+  };
+  for (auto& v:VECTORS) {
+    const auto got = Philox4x32::bijection(v.counter, v.key[0], v.key[1]);
+    for (size_t i = 0; i < 4; ++i)
+      if (got[i] != v.expected[i]) return false;
+  }
+  return true;
+}
+static_assert(philox_known_answers(), "Philox4x32 differs from Random123");
+
+// 64 random bits from either a 64-bit or a 32-bit engine
+template <typename Engine>
+inline uint64_t random_bits(Engine& engine) {
+  static_assert(Engine::min() == 0, "The engine must start at zero");
+  if constexpr (Engine::max() == UINT64_MAX) {
+    return engine();
+  } else {
+    static_assert(Engine::max() == UINT32_MAX,
+                  "The engine must produce 32 or 64 bits");
+    const uint64_t high = engine();
+    return (high << 32) | engine();
+  }
+}
+
+// Lemire's nearly divisionless method: uniform in [0, range), or the raw
+// 64 bits when range is zero (the full 2^64 span).
+template <typename Engine>
+inline uint64_t bounded_random(Engine& engine, uint64_t range) {
+  if constexpr (Engine::max() == UINT32_MAX) {
+    // One draw is enough when the range fits the engine's 32 bits
+    if (range != 0 && range <= UINT32_MAX) {
+      const uint32_t range32 = uint32_t(range);
+      uint64_t m = uint64_t(uint32_t(engine())) * range32;
+      uint32_t low = uint32_t(m);
+      if (low < range32) {
+        const uint32_t threshold = -range32 % range32;
+        while (low < threshold) {
+          m = uint64_t(uint32_t(engine())) * range32;
+          low = uint32_t(m);
+        }
+      }
+      return m >> 32;
+    }
+  }
+  uint64_t x = random_bits(engine);
+  if (range == 0) return x;
+  __uint128_t m = __uint128_t(x) * range;
+  uint64_t low = uint64_t(m);
+  if (low < range) {
+    const uint64_t threshold = -range % range;
+    while (low < threshold) {
+      x = random_bits(engine);
+      m = __uint128_t(x) * range;
+      low = uint64_t(m);
+    }
+  }
+  return uint64_t(m >> 64);
+}
 
 template <typename T>
 struct IGenerator {
   virtual ~IGenerator() = default;
   virtual T get() = 0;
+
+  // One virtual call for a whole batch of values
+  virtual void fill(T* first, size_t count) {
+    for (size_t i = 0; i < count; ++i) first[i] = get();
+  }
 };
 
-template <typename T>
+template <typename T, typename Engine = std::mt19937>
 class RandomGenerator : public IGenerator<T> {
 protected:
-  static constexpr auto DEFAULT_SEED= 1729u;
-  std::mt19937 gen;
+  static constexpr auto DEFAULT_SEED = 1729u;
+  Engine gen;
 
-  RandomGenerator(uint_fast32_t seed = DEFAULT_SEED)
+  RandomGenerator(uint64_t seed = DEFAULT_SEED)
     : gen(seed) {
   }
+
+  RandomGenerator(const Engine& engine)
+    : gen(engine) {
+  }
 };
 
-template <typename T = double>
-class RandomFloatingGenerator : public RandomGenerator<T> {
-  std::uniform_real_distribution<T> dist;
+template <typename T = double, typename Engine = std::mt19937>
+class RandomFloatingGenerator : public RandomGenerator<T, Engine> {
+  T from;
+  T scale;
 
 protected:
   T next() {
-    return dist(RandomGenerator<T>::gen);
+    // 53 random bits mapped onto [0, 1)
+    const double unit = (random_bits(RandomGenerator<T, Engine>::gen) >> 11)
+                        * 0x1.0p-53;
+    return from + static_cast<T>(unit * scale);
   }
 
 public:
-  RandomFloatingGenerator(T from, T to, uint_fast32_t seed)
-    : RandomGenerator<T>(seed), dist(from, to) {
+  RandomFloatingGenerator(T from, T to, uint64_t seed)
+    : RandomGenerator<T, Engine>(seed), from(from), scale(to - from) {
   }
 
   RandomFloatingGenerator(T from, T to)
-    : RandomGenerator<T>(), dist(from, to) {
+    : RandomGenerator<T, Engine>(), from(from), scale(to - from) {
+  }
+
+  RandomFloatingGenerator(T from, T to, const Engine& engine)
+    : RandomGenerator<T, Engine>(engine), from(from), scale(to - from) {
+  }
+
+  // Same bounds on an independent stream; needs an engine with split()
+  RandomFloatingGenerator split(uint64_t stream_id) const {
+    return RandomFloatingGenerator(
+      from, from + scale, RandomGenerator<T, Engine>::gen.split(stream_id));
   }
 
   virtual ~RandomFloatingGenerator() = default;
   virtual T get() override {
     return next();
   }
+
+  virtual void fill(T* first, size_t count) override {
+    for (size_t i = 0; i < count; ++i) first[i] = next();
+  }
 };
 
-template <typename T = int>
-class RandomNumericGenerator : public RandomGenerator<T> {
-  std::uniform_int_distribution<T> dist;
+template <typename T = int, typename Engine = std::mt19937>
+class RandomNumericGenerator : public RandomGenerator<T, Engine> {
+  static_assert(sizeof(T) <= sizeof(uint64_t));
+  T from;
+  uint64_t range;
 
 protected:
   T next() {
-    return dist(RandomGenerator<T>::gen);
+    const uint64_t offset
+      = bounded_random(RandomGenerator<T, Engine>::gen, range);
+    return static_cast<T>(static_cast<uint64_t>(from) + offset);
   }
 
 public:
-  RandomNumericGenerator(T from, T to, uint_fast32_t seed)
-    : RandomGenerator<T>(seed), dist(from, to) {
+  // Both bounds are inclusive
+  RandomNumericGenerator(T from, T to, uint64_t seed)
+    : RandomGenerator<T, Engine>(seed), from(from),
+      range(static_cast<uint64_t>(to) - static_cast<uint64_t>(from) + 1) {
   }
 
   RandomNumericGenerator(T from, T to)
-    : RandomGenerator<T>(), dist(from, to) {
+    : RandomGenerator<T, Engine>(), from(from),
+      range(static_cast<uint64_t>(to) - static_cast<uint64_t>(from) + 1) {
+  }
+
+  RandomNumericGenerator(T from, T to, const Engine& engine)
+    : RandomGenerator<T, Engine>(engine), from(from),
+      range(static_cast<uint64_t>(to) - static_cast<uint64_t>(from) + 1) {
+  }
+
+  // Same bounds on an independent stream; needs an engine with split()
+  RandomNumericGenerator split(uint64_t stream_id) const {
+    const T to = static_cast<T>(static_cast<uint64_t>(from) + range - 1);
+    return RandomNumericGenerator(
+      from, to, RandomGenerator<T, Engine>::gen.split(stream_id));
   }
 
   virtual ~RandomNumericGenerator() = default;
   virtual T get() override {
     return next();
   }
+
+  virtual void fill(T* first, size_t count) override {
+    for (size_t i = 0; i < count; ++i) first[i] = next();
+  }
 };
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Byte-oriented LZ77 in the style of LZ4: a hash of the next four bytes
+// finds the previous occurrence within 64 KiB, and the output is a list
+// of sequences
+//   token (literal count << 4 | match length - 4), [extra literal count],
+//   literals, uint16 offset, [extra match length]
+// where a nibble of 15 is continued by bytes of 255 and a final byte.
+// The last sequence has literals only. Blocks are independent.
+class LzCodec {
+  static constexpr size_t MIN_MATCH = 4;
+  static constexpr size_t MAX_OFFSET = 65535;
+  static constexpr unsigned HASH_BITS = 14;
+
+  // Positions + 1 of the last occurrence of each hash, 0 when unseen
+  std::array<uint32_t, size_t(1) << HASH_BITS> table;
+
+  static uint32_t hash(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+  }
+
+  static void put_length(std::string& out, size_t n) {
+    for (; n >= 255; n -= 255) out.push_back(char(255));
+    out.push_back(char(n));
+  }
+
+  static void put_sequence(std::string& out, const char* literals,
+                           size_t literal_count, size_t offset,
+                           size_t match_length) {
+    const size_t match_code = match_length ? match_length - MIN_MATCH : 0;
+    const size_t literal_nibble = std::min<size_t>(literal_count, 15);
+    const size_t match_nibble = std::min<size_t>(match_code, 15);
+    out.push_back(char(literal_nibble << 4 | match_nibble));
+    if (literal_nibble == 15) put_length(out, literal_count - 15);
+    out.append(literals, literal_count);
+    if (match_length == 0) return;
+    out.push_back(char(offset & 0xff));
+    out.push_back(char(offset >> 8));
+    if (match_nibble == 15) put_length(out, match_code - 15);
+  }
+
+public:
+  // Appends the compressed form of src to out.
+  void compress(std::string_view src, std::string& out) {
+    if (src.size() > UINT32_MAX - 1)
+      throw std::invalid_argument("The block is too large");
+    table.fill(0);
+    const char* base = src.data();
+    const size_t n = src.size();
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + MIN_MATCH <= n) {
+      const uint32_t h = hash(base + i);
+      const size_t candidate = table[h];
+      table[h] = static_cast<uint32_t>(i + 1);
+      if (candidate == 0 || i - (candidate - 1) > MAX_OFFSET
+          || std::memcmp(base + candidate - 1, base + i, MIN_MATCH) != 0) {
+        ++i;
+        continue;
+      }
+
+      const size_t match = candidate - 1;
+      size_t length = MIN_MATCH;
+      while (i + length < n && base[match + length] == base[i + length])
+        ++length;
+      put_sequence(out, base + anchor, i - anchor, i - match, length);
+      i += length;
+      anchor = i;
+    }
+    put_sequence(out, base + anchor, n - anchor, 0, 0);
+  }
+
+  // Expands src, which must decode to exactly size bytes.
+  static std::string decompress(std::string_view src, size_t size) {
+    std::string out(size, '\0');
+    const auto* p = reinterpret_cast<const uint8_t*>(src.data());
+    const auto* end = p + src.size();
+    size_t o = 0;
+
+    auto corrupt = [] {
+      return std::runtime_error("Corrupt compressed block");
+    };
+    auto get_length = [&](size_t n) {
+      uint8_t byte;
+      do {
+        if (p == end) throw corrupt();
+        byte = *p++;
+        n += byte;
+      } while (byte == 255);
+      return n;
+    };
+
+    while (p < end) {
+      const uint8_t token = *p++;
+      size_t literals = token >> 4;
+      if (literals == 15) literals = get_length(literals);
+      if (size_t(end - p) < literals || size - o < literals) throw corrupt();
+      std::memcpy(&out[o], p, literals);
+      p += literals;
+      o += literals;
+      if (p == end) break;
+
+      if (end - p < 2) throw corrupt();
+      const size_t offset = p[0] | size_t(p[1]) << 8;
+      p += 2;
+      size_t length = token & 15;
+      if (length == 15) length = get_length(length);
+      length += MIN_MATCH;
+      if (offset == 0 || offset > o || size - o < length) throw corrupt();
+      // Byte by byte, since the match may overlap what it produces
+      for (size_t k = 0; k < length; ++k, ++o) out[o] = out[o - offset];
+    }
+    if (o != size) throw corrupt();
+    return out;
+  }
+};
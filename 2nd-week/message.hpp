@@ -1,64 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
 #include <iostream>
+#include <string_view>
 
 #include "resource_utilization.hpp"
+#include "proc_resource_utilization.hpp"
+#include "sample.hpp"
+
+// Text known at compile time, e.g. a label joined with its separator
+template <size_t N>
+struct StaticText {
+  char text[N] {};
+
+  constexpr StaticText(std::initializer_list<std::string_view> parts) {
+    size_t n = 0;
+    for (auto part:parts)
+      for (auto ch:part) text[n++] = ch;
+  }
+
+  constexpr std::string_view view() const {
+    return std::string_view(text, N);
+  }
+};
 
 struct IMessage {
+  // Size of the buffer format_to() writes into
+  static constexpr size_t MAX_FORMATTED = 128;
+
   ~IMessage() = default;
   virtual std::ostream& operator<<(std::ostream& o) = 0;
+
+  virtual std::string_view label() const = 0;
+  virtual std::string_view unit() const = 0;
+  virtual Value sample() = 0;
+
+  // Writes "label: value unit\n" into buf, which holds MAX_FORMATTED
+  // bytes, and returns the length. No stream or allocation involved;
+  // overrides can use compile-time affixes.
+  virtual size_t format_to(char* buf, const Value& value) const {
+    char* const last = buf + MAX_FORMATTED;
+    auto put = [&](char* p, std::string_view text) {
+      const size_t n = std::min<size_t>(text.size(), last - p);
+      std::memcpy(p, text.data(), n);
+      return p + n;
+    };
+    char* p = put(buf, label());
+    p = put(p, ": ");
+    p = to_chars(p, last, value);
+    p = put(p, " ");
+    p = put(p, unit());
+    return put(p, "\n") - buf;
+  }
 };
 
-std::ostream& operator<<(std::ostream& o, IMessage& msg) {
+inline std::ostream& operator<<(std::ostream& o, IMessage& msg) {
   return msg << o;
 }
 
-class CpuUtilizationMessage : public IMessage {
-  CpuUtilization<> cpu_usage;
-
-public:
-  virtual ~CpuUtilizationMessage() = default;
+// Writes a previously sampled value the same way operator<< does
+inline std::ostream& format(std::ostream& o, const IMessage& msg,
+                            const Value& value) {
+  char buf[IMessage::MAX_FORMATTED];
+  return o.write(buf, msg.format_to(buf, value));
+}
 
-  virtual std::ostream& operator<<(std::ostream& o) override {
-    o << "CPU utilization: " << cpu_usage.get()
-      << " " << cpu_usage.unit() << std::endl;
-    return o;
-  };
-};
+template <typename Resource, typename T>
+class UtilizationMessage : public IMessage {
+  static constexpr StaticText<T::label.size() + 2> prefix {T::label, ": "};
+  static constexpr StaticText<Resource::UNIT.size() + 2> suffix
+    {" ", Resource::UNIT, "\n"};
+  // Longest value: a negative double in exponent form or an int64
+  static_assert(prefix.view().size() + 24 + suffix.view().size()
+                <= MAX_FORMATTED);
 
-class DiskUtilizationMessage : public IMessage {
-  DiskUtilization<> disk_usage;
+  Resource usage;
 
 public:
-  virtual ~DiskUtilizationMessage() = default;
+  virtual ~UtilizationMessage() = default;
 
   virtual std::ostream& operator<<(std::ostream& o) override {
-    o << "Disk utilization: " << disk_usage.get()
-      << " " << disk_usage.unit() << std::endl;
-    return o;
-  };
-};
+    return format(o, *this, sample());
+  }
 
-class MemoryUtilizationMessage : public IMessage {
-  MemoryUtilization<> memory_usage;
+  virtual std::string_view label() const override {
+    return T::label;
+  }
 
-public:
-  virtual ~MemoryUtilizationMessage() = default;
+  virtual std::string_view unit() const override {
+    return usage.unit();
+  }
 
-  virtual std::ostream& operator<<(std::ostream& o) override {
-    o << "Memory utilization: " << memory_usage.get()
-      << " " << memory_usage.unit() << std::endl;
-    return o;
-  };
+  virtual Value sample() override {
+    return Value(usage.get());
+  }
+
+  virtual size_t format_to(char* buf, const Value& value) const override {
+    std::memcpy(buf, prefix.text, sizeof(prefix.text));
+    char* p = to_chars(buf + sizeof(prefix.text),
+                       buf + MAX_FORMATTED - sizeof(suffix.text), value);
+    std::memcpy(p, suffix.text, sizeof(suffix.text));
+    return p + sizeof(suffix.text) - buf;
+  }
+};
+
+struct CpuUtilizationMessageInternal {
+  static constexpr auto label = std::string_view("CPU utilization");
 };
+using CpuUtilizationMessage
+  = UtilizationMessage<CpuUtilization<>, CpuUtilizationMessageInternal>;
 
-class NetworkUtilizationMessage : public IMessage {
-  NetworkUtilization<> network_usage;
+struct DiskUtilizationMessageInternal {
+  static constexpr auto label = std::string_view("Disk utilization");
+};
+using DiskUtilizationMessage
+  = UtilizationMessage<DiskUtilization<>, DiskUtilizationMessageInternal>;
 
-public:
-  virtual ~NetworkUtilizationMessage() = default;
+struct MemoryUtilizationMessageInternal {
+  static constexpr auto label = std::string_view("Memory utilization");
+};
+using MemoryUtilizationMessage
+  = UtilizationMessage<MemoryUtilization<>, MemoryUtilizationMessageInternal>;
 
-  virtual std::ostream& operator<<(std::ostream& o) override {
-    o << "Network utilization: " << network_usage.get()
-      << " " << network_usage.unit() << std::endl;
-    return o;
-  };
+struct NetworkUtilizationMessageInternal {
+  static constexpr auto label = std::string_view("Network utilization");
 };
+using NetworkUtilizationMessage
+  = UtilizationMessage<NetworkUtilization<>, NetworkUtilizationMessageInternal>;
+
+// Readings of the running Linux host instead of random numbers
+using ProcCpuUtilizationMessage
+  = UtilizationMessage<ProcCpuUtilization<>, CpuUtilizationMessageInternal>;
+using ProcDiskUtilizationMessage
+  = UtilizationMessage<ProcDiskUtilization<>, DiskUtilizationMessageInternal>;
+using ProcMemoryUtilizationMessage
+  = UtilizationMessage<ProcMemoryUtilization<>,
+                       MemoryUtilizationMessageInternal>;
+using ProcNetworkUtilizationMessage
+  = UtilizationMessage<ProcNetworkUtilization<>,
+                       NetworkUtilizationMessageInternal>;
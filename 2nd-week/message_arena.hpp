@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <ostream>
+#include <streambuf>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Append-only buffer that lives for one notify cycle.
+// Each message is formatted into it once and handed out as a string_view,
+// so the cost does not depend on the number of observers. The storage is
+// reused across cycles and only grows, so a warmed-up arena never allocates.
+class MessageArena : public std::streambuf {
+  std::vector<char> buffer;
+  std::vector<std::pair<size_t, size_t>> spans;
+  size_t mark = 0;
+  std::ostream out;
+
+  size_t used() const {
+    return pptr() - pbase();
+  }
+
+  void reset_put_area(size_t offset) {
+    setp(buffer.data(), buffer.data() + buffer.size());
+    pbump(static_cast<int>(offset));
+  }
+
+protected:
+  virtual int_type overflow(int_type ch) override {
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+      return traits_type::not_eof(ch);
+    const size_t offset = used();
+    buffer.resize(buffer.size() * 2);
+    reset_put_area(offset);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+  }
+
+public:
+  MessageArena(size_t reserve = 4096)
+    : buffer(reserve > 0 ? reserve : 1), out(this) {
+    reset_put_area(0);
+  }
+
+  MessageArena(const MessageArena&) = delete;
+  MessageArena& operator=(const MessageArena&) = delete;
+
+  std::ostream& stream() {
+    return out;
+  }
+
+  // Room for n bytes written in place, bypassing the stream; follow
+  // with commit(written).
+  char* prepare(size_t n) {
+    const size_t offset = used();
+    if (buffer.size() - offset < n) {
+      buffer.resize(std::max(buffer.size() * 2, offset + n));
+      reset_put_area(offset);
+    }
+    return pptr();
+  }
+
+  // Closes the message written since the previous commit().
+  void commit() {
+    spans.emplace_back(mark, used() - mark);
+    mark = used();
+  }
+
+  void commit(size_t written) {
+    pbump(static_cast<int>(written));
+    commit();
+  }
+
+  void clear() {
+    spans.clear();
+    mark = 0;
+    reset_put_area(0);
+  }
+
+  size_t size() const {
+    return spans.size();
+  }
+
+  // Views are stable until the next clear() once all messages are committed.
+  std::string_view operator[](size_t i) const {
+    return std::string_view(buffer.data() + spans[i].first, spans[i].second);
+  }
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+enum class BackPressure {
+  Block,
+  DropNewest,
+  DropOldest
+};
+
+// Bounded lock-free ring with a sequence number per slot.
+// Any thread may push; pop is also safe to race, which lets a producer
+// retire the oldest record by itself under BackPressure::DropOldest.
+// push_all() claims consecutive slots, so its records stay together.
+template <typename T>
+class MpscRing {
+  struct alignas(64) Slot {
+    std::atomic<size_t> seq;
+    T value;
+  };
+
+  const size_t mask;
+  std::unique_ptr<Slot[]> slots;
+  alignas(64) std::atomic<size_t> head {0};
+  alignas(64) std::atomic<size_t> tail {0};
+  alignas(64) std::atomic<size_t> dropped {0};
+  std::atomic<size_t> max_depth {0};
+
+  static size_t round_up(size_t capacity) {
+    if (capacity == 0)
+      throw std::invalid_argument("The capacity must be positive");
+    size_t n = 1;
+    while (n < capacity) n <<= 1;
+    return n;
+  }
+
+  bool try_push(const T& value) {
+    size_t pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots[pos & mask];
+      const size_t seq = slot.seq.load(std::memory_order_acquire);
+      const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (head.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+          slot.value = value;
+          slot.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool try_push_all(const T* values, size_t n) {
+    size_t pos = head.load(std::memory_order_relaxed);
+    for (;;) {
+      intptr_t diff = 0;
+      for (size_t i = 0; i < n && diff == 0; ++i) {
+        const size_t seq = slots[(pos + i) & mask].seq.load(
+          std::memory_order_acquire);
+        diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + i);
+      }
+      if (diff == 0) {
+        if (head.compare_exchange_weak(pos, pos + n,
+                                       std::memory_order_relaxed)) {
+          for (size_t i = 0; i < n; ++i) {
+            Slot& slot = slots[(pos + i) & mask];
+            slot.value = values[i];
+            slot.seq.store(pos + i + 1, std::memory_order_release);
+          }
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void update_max_depth() {
+    const size_t current = depth();
+    size_t seen = max_depth.load(std::memory_order_relaxed);
+    while (current > seen
+           && !max_depth.compare_exchange_weak(seen, current,
+                                               std::memory_order_relaxed)) {
+    }
+  }
+
+public:
+  MpscRing(size_t capacity)
+    : mask(round_up(capacity) - 1), slots(new Slot[mask + 1]) {
+    for (size_t i = 0; i <= mask; ++i)
+      slots[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  // Returns false only when the record was dropped.
+  bool push(const T& value, BackPressure policy) {
+    bool pushed = try_push(value);
+    if (!pushed) {
+      switch (policy) {
+      case BackPressure::Block:
+        while (!try_push(value)) std::this_thread::yield();
+        pushed = true;
+        break;
+      case BackPressure::DropNewest:
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        break;
+      case BackPressure::DropOldest: {
+        T victim;
+        while (!try_push(value)) {
+          if (pop(victim)) dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        pushed = true;
+        break;
+      }
+      }
+    }
+    if (pushed) update_max_depth();
+    return pushed;
+  }
+
+  // Pushes n records into consecutive slots, or drops all of them;
+  // n must not exceed capacity().
+  bool push_all(const T* values, size_t n, BackPressure policy) {
+    if (n > capacity())
+      throw std::invalid_argument("More records than the ring holds");
+    bool pushed = try_push_all(values, n);
+    if (!pushed) {
+      switch (policy) {
+      case BackPressure::Block:
+        while (!try_push_all(values, n)) std::this_thread::yield();
+        pushed = true;
+        break;
+      case BackPressure::DropNewest:
+        dropped.fetch_add(n, std::memory_order_relaxed);
+        break;
+      case BackPressure::DropOldest: {
+        T victim;
+        while (!try_push_all(values, n)) {
+          if (pop(victim)) dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        pushed = true;
+        break;
+      }
+      }
+    }
+    if (pushed) update_max_depth();
+    return pushed;
+  }
+
+  bool pop(T& value) {
+    size_t pos = tail.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots[pos & mask];
+      const size_t seq = slot.seq.load(std::memory_order_acquire);
+      const auto diff
+        = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed)) {
+          value = slot.value;
+          slot.seq.store(pos + mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  size_t capacity() const {
+    return mask + 1;
+  }
+
+  size_t depth() const {
+    const size_t t = tail.load(std::memory_order_relaxed);
+    const size_t h = head.load(std::memory_order_relaxed);
+    return h > t ? h - t : 0;
+  }
+
+  size_t drops() const {
+    return dropped.load(std::memory_order_relaxed);
+  }
+
+  size_t high_water_mark() const {
+    return max_depth.load(std::memory_order_relaxed);
+  }
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "rcu.hpp"
+
+// Resources an observer listens to, as a bitmask over resource ids.
+// A default-constructed filter matches every resource.
+class ResourceFilter {
+  std::vector<uint64_t> bits;
+  bool everything = true;
+
+public:
+  void add(uint32_t id) {
+    everything = false;
+    if (bits.size() <= id / 64) bits.resize(id / 64 + 1);
+    bits[id / 64] |= uint64_t(1) << (id % 64);
+  }
+
+  bool matches(uint32_t id) const {
+    if (everything) return true;
+    return id / 64 < bits.size() && (bits[id / 64] >> (id % 64) & 1);
+  }
+};
+
+template <typename Observer>
+struct Subscription {
+  Observer* observer;
+  ResourceFilter filter;
+};
+
+// Contiguous, immutable array of subscriptions; subscribe and unsubscribe
+// publish a new copy, so notify iterates without locking.
+template <typename Observer>
+class ObserverList {
+  using List = std::vector<Subscription<Observer>>;
+
+  RcuCell<List> subscriptions;
+
+public:
+  void add(Observer& obj, const ResourceFilter& filter = ResourceFilter()) {
+    subscriptions.update([&](const List& list) {
+      List updated;
+      updated.reserve(list.size() + 1);
+      for (auto& subscription:list)
+        if (subscription.observer != &obj) updated.push_back(subscription);
+      updated.push_back(Subscription<Observer>{&obj, filter});
+      return updated;
+    });
+  }
+
+  void remove(Observer& obj) {
+    subscriptions.update([&](const List& list) {
+      List updated;
+      updated.reserve(list.size());
+      for (auto& subscription:list)
+        if (subscription.observer != &obj) updated.push_back(subscription);
+      return updated;
+    });
+  }
+
+  typename RcuCell<List>::View snapshot() const {
+    return subscriptions.read();
+  }
+};
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/statvfs.h>
+
+#include "resource_utilization.hpp"
+
+// Keeps a file open and re-reads it with pread() into a fixed buffer,
+// so sampling costs one syscall and no allocation.
+template <size_t N = 4096>
+class ProcFile {
+  int fd;
+  char buffer[N];
+
+public:
+  ProcFile(const char* path)
+    : fd(::open(path, O_RDONLY | O_CLOEXEC)) {
+    if (fd < 0)
+      throw std::runtime_error(
+        std::string("Cannot open ") + path + ": " + std::strerror(errno));
+  }
+
+  ProcFile(const ProcFile&) = delete;
+  ProcFile& operator=(const ProcFile&) = delete;
+
+  virtual ~ProcFile() {
+    ::close(fd);
+  }
+
+  std::string_view read() {
+    ssize_t n;
+    do {
+      n = ::pread(fd, buffer, N, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0)
+      throw std::runtime_error(std::string("pread: ") + std::strerror(errno));
+    return std::string_view(buffer, n);
+  }
+};
+
+// Allocation-free field parsing over a string_view cursor
+class ProcParser {
+  const char* cur;
+  const char* end;
+
+public:
+  ProcParser(std::string_view text)
+    : cur(text.data()), end(text.data() + text.size()) {
+  }
+
+  bool done() const {
+    return cur >= end;
+  }
+
+  // Moves past the next occurrence of token; false if there is none.
+  bool skip_past(std::string_view token) {
+    std::string_view rest(cur, end - cur);
+    auto pos = rest.find(token);
+    if (pos == std::string_view::npos) {
+      cur = end;
+      return false;
+    }
+    cur += pos + token.size();
+    return true;
+  }
+
+  void skip_line() {
+    while (cur < end && *cur != '\n') ++cur;
+    if (cur < end) ++cur;
+  }
+
+  uint64_t number() {
+    while (cur < end && (*cur == ' ' || *cur == '\t')) ++cur;
+    uint64_t value = 0;
+    auto [ptr, ec] = std::from_chars(cur, end, value);
+    if (ec != std::errc()) return 0;
+    cur = ptr;
+    return value;
+  }
+
+  // Returns the text up to ':' on the current line, trimmed.
+  std::string_view key() {
+    while (cur < end && *cur == ' ') ++cur;
+    const char* begin = cur;
+    while (cur < end && *cur != ':' && *cur != '\n') ++cur;
+    std::string_view k(begin, cur - begin);
+    if (cur < end && *cur == ':') ++cur;
+    return k;
+  }
+};
+
+// Busy share of all CPUs since the previous sample, from /proc/stat
+template <typename T = int>
+class ProcCpuUtilization : public IResourceUtilization<T> {
+  ProcFile<> stat {"/proc/stat"};
+  uint64_t last_busy = 0;
+  uint64_t last_total = 0;
+
+  // Busy and total jiffies since boot, false if /proc/stat is unreadable
+  bool read(uint64_t& busy, uint64_t& total) {
+    ProcParser parser(stat.read());
+    if (!parser.skip_past("cpu ")) return false;
+    uint64_t fields[8] = {};
+    for (auto& field:fields) field = parser.number();
+    // user nice system idle iowait irq softirq steal
+    total = 0;
+    for (auto field:fields) total += field;
+    busy = total - fields[3] - fields[4];
+    return true;
+  }
+
+public:
+  static constexpr std::string_view UNIT = "%";
+
+  // The baseline makes the first get() cover the time since construction
+  ProcCpuUtilization() {
+    read(last_busy, last_total);
+  }
+  virtual ~ProcCpuUtilization() = default;
+
+  virtual T get() override {
+    uint64_t busy, total;
+    if (!read(busy, total)) return T();
+    const uint64_t delta_total = total - last_total;
+    const uint64_t delta_busy = busy - last_busy;
+    last_total = total;
+    last_busy = busy;
+    if (delta_total == 0) return T();
+    return static_cast<T>(100.0 * delta_busy / delta_total);
+  }
+
+  virtual std::string_view unit() const override {
+    return UNIT;
+  }
+};
+
+// Used memory (MemTotal - MemAvailable) from /proc/meminfo
+template <typename T = double>
+class ProcMemoryUtilization : public IResourceUtilization<T> {
+  ProcFile<> meminfo {"/proc/meminfo"};
+
+public:
+  static constexpr std::string_view UNIT = "GB";
+
+  virtual ~ProcMemoryUtilization() = default;
+
+  virtual T get() override {
+    ProcParser parser(meminfo.read());
+    uint64_t total_kb = 0, available_kb = 0;
+    while (!parser.done() && (total_kb == 0 || available_kb == 0)) {
+      auto key = parser.key();
+      if (key == "MemTotal") total_kb = parser.number();
+      else if (key == "MemAvailable") available_kb = parser.number();
+      parser.skip_line();
+    }
+    return static_cast<T>(total_kb - available_kb) / (1 << 20);
+  }
+
+  virtual std::string_view unit() const override {
+    return UNIT;
+  }
+};
+
+// Bytes received and sent per second on every interface but loopback,
+// since the previous sample, from the counters in /proc/net/dev. The
+// first sample has nothing to compare with and reports 0.
+template <typename T = double>
+class ProcNetworkUtilization : public IResourceUtilization<T> {
+  ProcFile<16384> dev {"/proc/net/dev"};
+  uint64_t last_bytes = 0;
+  uint64_t last_ns = 0;
+
+  static uint64_t monotonic_ns() {
+    timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+public:
+  static constexpr std::string_view UNIT = "MB/s";
+
+  virtual ~ProcNetworkUtilization() = default;
+
+  virtual T get() override {
+    ProcParser parser(dev.read());
+    parser.skip_line();
+    parser.skip_line();
+    uint64_t bytes = 0;
+    while (!parser.done()) {
+      auto name = parser.key();
+      if (name.empty()) break;
+      uint64_t fields[9] = {};
+      for (auto& field:fields) field = parser.number();
+      // fields[0] is received bytes, fields[8] is transmitted bytes
+      if (name != "lo") bytes += fields[0] + fields[8];
+      parser.skip_line();
+    }
+
+    const uint64_t now = monotonic_ns();
+    const uint64_t delta_ns = now - last_ns;
+    // Counters restart when an interface goes away
+    const uint64_t delta_bytes = bytes >= last_bytes ? bytes - last_bytes : 0;
+    const bool first = last_ns == 0;
+    last_bytes = bytes;
+    last_ns = now;
+    if (first || delta_ns == 0) return T();
+    return static_cast<T>(delta_bytes * 1e9 / delta_ns / (1 << 20));
+  }
+
+  virtual std::string_view unit() const override {
+    return UNIT;
+  }
+};
+
+// Used space of the file system holding path, through fstatvfs()
+template <typename T = double>
+class ProcDiskUtilization : public IResourceUtilization<T> {
+  int fd;
+
+public:
+  static constexpr std::string_view UNIT = "TB";
+
+  ProcDiskUtilization(const char* path = "/")
+    : fd(::open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) {
+    if (fd < 0)
+      throw std::runtime_error(
+        std::string("Cannot open ") + path + ": " + std::strerror(errno));
+  }
+
+  ProcDiskUtilization(const ProcDiskUtilization&) = delete;
+  ProcDiskUtilization& operator=(const ProcDiskUtilization&) = delete;
+
+  virtual ~ProcDiskUtilization() {
+    ::close(fd);
+  }
+
+  virtual T get() override {
+    struct statvfs st;
+    if (::fstatvfs(fd, &st) < 0) return T();
+    const double used = static_cast<double>(st.f_blocks - st.f_bfree)
+                        * st.f_frsize;
+    return static_cast<T>(used / (uint64_t(1) << 40));
+  }
+
+  virtual std::string_view unit() const override {
+    return UNIT;
+  }
+};
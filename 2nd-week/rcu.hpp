@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Read-copy-update cell.
+// Readers pin the current immutable value without locking and use it for
+// as long as they hold the View. Writers are serialized and publish a new
+// value; the old one is retired and freed by a later update once every
+// reader that could see it is gone. Nothing waits, so a thread holding a
+// View may update the cell it reads.
+template <typename T>
+class RcuCell {
+  struct alignas(64) ReaderCount {
+    std::atomic<size_t> value {0};
+  };
+
+  std::atomic<const T*> current;
+  std::atomic<size_t> epoch {0};
+  mutable ReaderCount readers[2];
+  std::mutex writer_mtx;
+  // Guarded by writer_mtx: values retired in this epoch, and values
+  // retired in the previous one, which wait for its readers to leave
+  std::vector<const T*> retiring;
+  std::vector<const T*> draining;
+
+  static void free_all(std::vector<const T*>& values) {
+    for (auto value:values) delete value;
+    values.clear();
+  }
+
+  // Frees what no reader can hold, and moves to the next epoch once the
+  // previous one has no readers left, which its counter is reused for.
+  void reclaim() {
+    const size_t e = epoch.load();
+    if (readers[(e + 1) & 1].value.load() != 0) return;
+    free_all(draining);
+    if (retiring.empty()) return;
+    draining.swap(retiring);
+    epoch.store(e + 1);
+    if (readers[e & 1].value.load() == 0) free_all(draining);
+  }
+
+  void publish(const T* value) {
+    retiring.push_back(current.exchange(value));
+    reclaim();
+  }
+
+public:
+  class View {
+    const RcuCell* owner;
+    size_t slot;
+    const T* value;
+
+  public:
+    View(const RcuCell* owner)
+      : owner(owner) {
+      for (;;) {
+        const size_t e = owner->epoch.load();
+        slot = e & 1;
+        owner->readers[slot].value.fetch_add(1);
+        if (owner->epoch.load() == e) break;
+        owner->readers[slot].value.fetch_sub(1);
+      }
+      value = owner->current.load();
+    }
+
+    View(const View&) = delete;
+    View& operator=(const View&) = delete;
+
+    ~View() {
+      owner->readers[slot].value.fetch_sub(1);
+    }
+
+    const T& operator*() const {
+      return *value;
+    }
+
+    const T* operator->() const {
+      return value;
+    }
+
+    auto begin() const {
+      return value->cbegin();
+    }
+
+    auto end() const {
+      return value->cend();
+    }
+
+    size_t size() const {
+      return value->size();
+    }
+  };
+
+  RcuCell(T initial = T())
+    : current(new T(std::move(initial))) {
+  }
+
+  RcuCell(const RcuCell&) = delete;
+  RcuCell& operator=(const RcuCell&) = delete;
+
+  virtual ~RcuCell() {
+    free_all(retiring);
+    free_all(draining);
+    delete current.load();
+  }
+
+  // Never blocks
+  View read() const {
+    return View(this);
+  }
+
+  // f receives the current value and returns its replacement; if f
+  // throws, nothing is published. Never waits for readers.
+  template <typename F>
+  void update(F&& f) {
+    std::scoped_lock<std::mutex> lock {writer_mtx};
+    auto updated = std::make_unique<T>(f(*current.load()));
+    publish(updated.release());
+  }
+};
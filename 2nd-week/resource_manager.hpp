@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "rcu.hpp"
+
+template <typename T>
+struct ResourceEntry {
+  T* resource;
+  uint32_t id;
+};
+
+// Read-mostly registry kept in an RcuCell: iteration walks an immutable
+// snapshot without locking and writers pay for the copy. Every added
+// resource is interned to an id. The id of an erased resource goes to
+// the next add(), so tables indexed by id grow only with the number of
+// resources alive at once; clear any per-id state when erasing.
+template <typename T>
+class ResourceManager {
+public:
+  using Entry = std::pair<std::string_view, ResourceEntry<T>>;
+
+  // Entries in insertion order, with an open-addressing hash table of
+  // their positions by name. Both are flat, so a copy costs two
+  // allocations however many resources there are.
+  struct Snapshot {
+    std::vector<Entry> entries;
+    std::vector<uint32_t> slots;   // position + 1, or 0 when empty
+
+    size_t home(std::string_view name) const {
+      return std::hash<std::string_view>()(name) & (slots.size() - 1);
+    }
+
+    const Entry* find(std::string_view name) const {
+      if (slots.empty()) return nullptr;
+      const size_t mask = slots.size() - 1;
+      for (size_t i = home(name);; i = (i + 1) & mask) {
+        if (slots[i] == 0) return nullptr;
+        const Entry& entry = entries[slots[i] - 1];
+        if (entry.first == name) return &entry;
+      }
+    }
+
+    // Indexes the entry just appended, growing the table at half full
+    void index_back() {
+      if (entries.size() * 2 > slots.size()) reindex();
+      else place(entries.size() - 1);
+    }
+
+    void reindex() {
+      size_t n = 8;
+      while (n < entries.size() * 2) n *= 2;
+      slots.assign(n, 0);
+      for (size_t i = 0; i < entries.size(); ++i) place(i);
+    }
+
+    void place(size_t position) {
+      const size_t mask = slots.size() - 1;
+      size_t i = home(entries[position].first);
+      while (slots[i] != 0) i = (i + 1) & mask;
+      slots[i] = static_cast<uint32_t>(position + 1);
+    }
+
+    // Drops the slot of old.entries[position], which entries no longer
+    // holds, by shifting its probe chain back; later positions move down.
+    void unindex(const Snapshot& old, size_t position) {
+      const size_t mask = slots.size() - 1;
+      size_t hole = home(old.entries[position].first);
+      while (slots[hole] != position + 1) hole = (hole + 1) & mask;
+      for (size_t i = (hole + 1) & mask; slots[i] != 0; i = (i + 1) & mask) {
+        const size_t want = home(old.entries[slots[i] - 1].first);
+        // Move it unless its home lies cyclically in (hole, i]
+        const bool stays = hole < i ? hole < want && want <= i
+                                    : hole < want || want <= i;
+        if (stays) continue;
+        slots[hole] = slots[i];
+        hole = i;
+      }
+      slots[hole] = 0;
+      for (auto& slot:slots)
+        if (slot > position + 1) --slot;
+    }
+
+    auto cbegin() const {
+      return entries.cbegin();
+    }
+
+    auto cend() const {
+      return entries.cend();
+    }
+
+    size_t size() const {
+      return entries.size();
+    }
+  };
+
+private:
+  RcuCell<Snapshot> entries;
+  // Guarded by the cell's writer lock, as only update() touches them
+  uint32_t next_id;
+  std::vector<uint32_t> free_ids;
+  const uint32_t id_stride;
+
+
+public:
+  // Ids are first_id, first_id + id_stride, ...; registries that share
+  // an id space use distinct offsets into the same stride.
+  ResourceManager(uint32_t first_id = 0, uint32_t id_stride = 1)
+    : next_id(first_id), id_stride(id_stride) {
+  }
+
+  void add(std::string_view name, T& resource) {
+    entries.update([&](const Snapshot& snapshot) {
+      if (snapshot.find(name))
+        throw std::invalid_argument(
+          "The name \"" + std::string(name) + "\" exists");
+      Snapshot updated {{}, snapshot.slots};
+      updated.entries.reserve(snapshot.size() + 1);
+      updated.entries.insert(updated.entries.end(), snapshot.entries.begin(),
+                             snapshot.entries.end());
+      const bool reuse = !free_ids.empty();
+      const uint32_t id = reuse ? free_ids.back() : next_id;
+      updated.entries.emplace_back(name, ResourceEntry<T>{&resource, id});
+      updated.index_back();
+      if (reuse) free_ids.pop_back();
+      else next_id += id_stride;
+      return updated;
+    });
+  }
+
+  void erase(std::string_view name) {
+    entries.update([&](const Snapshot& snapshot) {
+      const Entry* erased = snapshot.find(name);
+      if (!erased)
+        throw std::invalid_argument(
+          "The name \"" + std::string(name) + "\" does not exist");
+      Snapshot updated {{}, snapshot.slots};
+      updated.entries.reserve(snapshot.size() - 1);
+      for (auto& entry:snapshot.entries)
+        if (&entry != erased) updated.entries.push_back(entry);
+      updated.unindex(snapshot, erased - snapshot.entries.data());
+      free_ids.push_back(erased->second.id);
+      return updated;
+    });
+  }
+
+  std::optional<ResourceEntry<T>> entry(std::string_view name) const {
+    auto view = entries.read();
+    auto found = view->find(name);
+    if (!found) return std::nullopt;
+    return found->second;
+  }
+
+  std::optional<uint32_t> id(std::string_view name) const {
+    auto found = entry(name);
+    if (!found) return std::nullopt;
+    return found->id;
+  }
+
+  // Never blocks; keep the view short-lived, as it holds back reclamation.
+  typename RcuCell<Snapshot>::View snapshot() const {
+    return entries.read();
+  }
+};
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <string_view>
 
 #include "generator.hpp"
@@ -14,6 +16,8 @@ class CpuUtilization : public IResourceUtilization<T> {
   RandomNumericGenerator<T> rand;
 
 public:
+  static constexpr std::string_view UNIT = "%";
+
   CpuUtilization()
     : rand(0, 100) {
   }
@@ -23,7 +27,7 @@ public:
     return rand.get();
   }
   virtual std::string_view unit() const override {
-    return "%";
+    return UNIT;
   }
 };
 
@@ -32,6 +36,8 @@ class DiskUtilization : public IResourceUtilization<T> {
   RandomFloatingGenerator<> rand;
 
 public:
+  static constexpr std::string_view UNIT = "TB";
+
   DiskUtilization()
     : rand(1, 1e3) {
   }
@@ -41,7 +47,7 @@ public:
     return rand.get();
   }
   virtual std::string_view unit() const override {
-    return "TB";
+    return UNIT;
   }
 };
 
@@ -50,6 +56,8 @@ class MemoryUtilization : public IResourceUtilization<T> {
   RandomFloatingGenerator<> rand;
 
 public:
+  static constexpr std::string_view UNIT = "GB";
+
   MemoryUtilization()
     : rand(2 << 3, 2 << 10) {
   }
@@ -59,7 +67,7 @@ public:
     return rand.get();
   }
   virtual std::string_view unit() const override {
-    return "GB";
+    return UNIT;
   }
 };
 
@@ -68,6 +76,8 @@ class NetworkUtilization : public IResourceUtilization<T> {
   RandomFloatingGenerator<> rand;
 
 public:
+  static constexpr std::string_view UNIT = "GB";
+
   NetworkUtilization()
     : rand(1e2, 1e3) {
   }
@@ -77,6 +87,6 @@ public:
     return rand.get();
   }
   virtual std::string_view unit() const override {
-    return "GB";
+    return UNIT;
   }
 };
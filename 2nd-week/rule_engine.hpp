@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "sample.hpp"
+
+enum class Comparison {
+  Above,
+  Below
+};
+
+// Fires once the value has been beyond threshold for `samples`
+// consecutive samples, and clears when it comes back past clear_at.
+// clear_at defaults to the threshold; set it lower (Above) or higher
+// (Below) for hysteresis.
+struct AlertRule {
+  std::string name;
+  uint32_t resource_id;
+  Comparison comparison;
+  double threshold;
+  uint32_t samples = 1;
+  double clear_at = std::numeric_limits<double>::quiet_NaN();
+};
+
+struct AlertEvent {
+  const AlertRule& rule;
+  const Sample& sample;
+  bool firing;              // false when the alert clears
+};
+
+// Rules are compiled into columns per resource: for each rule a sign
+// and two thresholds, so that every condition reads sign * v > limit.
+// A sample is checked against all rules of its resource at once, four or
+// two lanes per instruction, producing 64-rule bitmasks. Firing state
+// and running streaks are bitsets; per-rule counters are only touched for
+// rules whose condition holds or just stopped holding.
+class RuleEngine {
+  static constexpr size_t WORD = 64;
+
+  struct Group {
+    size_t first = 0;     // first column, a multiple of WORD
+    size_t words = 0;
+  };
+
+  std::vector<AlertRule> rules;
+  std::vector<size_t> rule_of;       // column -> rule, SIZE_MAX for padding
+  std::vector<Group> groups;         // by resource id
+  std::vector<double> sign;
+  std::vector<double> set_limit;
+  std::vector<double> hold_limit;
+  std::vector<uint16_t> required;
+  std::vector<uint16_t> streak;
+  std::vector<uint64_t> firing;
+  std::vector<uint64_t> streaking;
+
+  // Bit i set when sign[i] * v > limit[i], for the WORD columns at base
+  static uint64_t compare(double v, const double* s, const double* limit) {
+    uint64_t mask = 0;
+#if defined(__AVX2__)
+    const __m256d value = _mm256_set1_pd(v);
+    for (size_t i = 0; i < WORD; i += 4) {
+      const __m256d x = _mm256_mul_pd(value, _mm256_loadu_pd(s + i));
+      const __m256d gt = _mm256_cmp_pd(x, _mm256_loadu_pd(limit + i),
+                                       _CMP_GT_OQ);
+      mask |= uint64_t(_mm256_movemask_pd(gt)) << i;
+    }
+#elif defined(__SSE2__)
+    const __m128d value = _mm_set1_pd(v);
+    for (size_t i = 0; i < WORD; i += 2) {
+      const __m128d x = _mm_mul_pd(value, _mm_loadu_pd(s + i));
+      const __m128d gt = _mm_cmpgt_pd(x, _mm_loadu_pd(limit + i));
+      mask |= uint64_t(_mm_movemask_pd(gt)) << i;
+    }
+#else
+    for (size_t i = 0; i < WORD; ++i)
+      mask |= uint64_t(v * s[i] > limit[i]) << i;
+#endif
+    return mask;
+  }
+
+  template <typename F>
+  static void for_each_bit(uint64_t bits, F&& f) {
+    while (bits) {
+      f(static_cast<size_t>(__builtin_ctzll(bits)));
+      bits &= bits - 1;
+    }
+  }
+
+public:
+  RuleEngine(const std::vector<AlertRule>& alert_rules)
+    : rules(alert_rules) {
+    std::vector<std::vector<size_t>> by_resource;
+    for (size_t i = 0; i < rules.size(); ++i) {
+      const AlertRule& rule = rules[i];
+      if (rule.samples == 0 || rule.samples > UINT16_MAX)
+        throw std::invalid_argument(
+          "Rule \"" + rule.name + "\" needs 1 to 65535 samples");
+      if (by_resource.size() <= rule.resource_id)
+        by_resource.resize(rule.resource_id + 1);
+      by_resource[rule.resource_id].push_back(i);
+    }
+
+    groups.resize(by_resource.size());
+    for (size_t id = 0; id < by_resource.size(); ++id) {
+      const auto& members = by_resource[id];
+      if (members.empty()) continue;
+      Group& group = groups[id];
+      group.first = rule_of.size();
+      group.words = (members.size() + WORD - 1) / WORD;
+      for (size_t k = 0; k < group.words * WORD; ++k) {
+        if (k >= members.size()) {
+          // Padding never matches
+          rule_of.push_back(SIZE_MAX);
+          sign.push_back(1);
+          set_limit.push_back(std::numeric_limits<double>::infinity());
+          hold_limit.push_back(std::numeric_limits<double>::infinity());
+          required.push_back(1);
+          continue;
+        }
+        const AlertRule& rule = rules[members[k]];
+        const double s = rule.comparison == Comparison::Above ? 1 : -1;
+        const double clear = std::isnan(rule.clear_at)
+          ? rule.threshold : rule.clear_at;
+        rule_of.push_back(members[k]);
+        sign.push_back(s);
+        set_limit.push_back(s * rule.threshold);
+        hold_limit.push_back(s * clear);
+        required.push_back(static_cast<uint16_t>(rule.samples));
+      }
+    }
+    streak.assign(rule_of.size(), 0);
+    firing.assign(rule_of.size() / WORD, 0);
+    streaking.assign(rule_of.size() / WORD, 0);
+  }
+
+  // Checks every rule of the sample's resource; calls emit(AlertEvent)
+  // for each alert that starts or clears.
+  template <typename Emit>
+  void evaluate(const Sample& sample, Emit&& emit) {
+    if (sample.resource_id >= groups.size()) return;
+    const Group& group = groups[sample.resource_id];
+    const double v = sample.value.as_double();
+    for (size_t w = 0; w < group.words; ++w) {
+      const size_t base = group.first + w * WORD;
+      const size_t word = base / WORD;
+      const uint64_t set = compare(v, &sign[base], &set_limit[base]);
+      uint64_t& on = firing[word];
+      uint64_t& counting = streaking[word];
+
+      // Streaks end where the condition no longer holds
+      for_each_bit(counting & ~set, [&](size_t bit) {
+        streak[base + bit] = 0;
+      });
+      counting &= set;
+
+      uint64_t started = 0;
+      for_each_bit(set & ~on, [&](size_t bit) {
+        uint16_t& n = streak[base + bit];
+        if (n < required[base + bit]) ++n;
+        if (n >= required[base + bit]) started |= uint64_t(1) << bit;
+      });
+      counting |= set & ~on;
+
+      uint64_t cleared = 0;
+      if (on) {
+        const uint64_t hold = compare(v, &sign[base], &hold_limit[base]);
+        cleared = on & ~hold & ~set;
+      }
+      on = (on & ~cleared) | started;
+      counting &= ~started;
+      for_each_bit(started | cleared, [&](size_t bit) {
+        streak[base + bit] = 0;
+      });
+
+      for_each_bit(started, [&](size_t bit) {
+        emit(AlertEvent{rules[rule_of[base + bit]], sample, true});
+      });
+      for_each_bit(cleared, [&](size_t bit) {
+        emit(AlertEvent{rules[rule_of[base + bit]], sample, false});
+      });
+    }
+  }
+
+  size_t size() const {
+    return rules.size();
+  }
+
+  size_t firing_count() const {
+    size_t n = 0;
+    for (auto word:firing) n += __builtin_popcountll(word);
+    return n;
+  }
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <type_traits>
+
+#include "tsc_clock.hpp"
+
+enum class ValueType : uint8_t {
+  Integer = 0,
+  Floating = 1
+};
+
+struct Value {
+  ValueType type = ValueType::Integer;
+  union {
+    int64_t integer = 0;
+    double floating;
+  };
+
+  Value() = default;
+
+  template <typename T,
+            typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+  Value(T v) {
+    if constexpr (std::is_floating_point_v<T>) {
+      type = ValueType::Floating;
+      floating = v;
+    } else {
+      type = ValueType::Integer;
+      integer = v;
+    }
+  }
+
+  double as_double() const {
+    return type == ValueType::Floating
+      ? floating : static_cast<double>(integer);
+  }
+
+  // The 64 bits of whichever member is active, for storage
+  uint64_t bits() const {
+    uint64_t b;
+    if (type == ValueType::Floating) std::memcpy(&b, &floating, sizeof(b));
+    else std::memcpy(&b, &integer, sizeof(b));
+    return b;
+  }
+
+  static Value from_bits(ValueType type, uint64_t b) {
+    if (type != ValueType::Floating) return Value(static_cast<int64_t>(b));
+    double d;
+    std::memcpy(&d, &b, sizeof(d));
+    return Value(d);
+  }
+};
+
+inline std::ostream& operator<<(std::ostream& o, const Value& value) {
+  if (value.type == ValueType::Floating) o << value.floating;
+  else o << value.integer;
+  return o;
+}
+
+// Same text as operator<< with default stream flags: integers in
+// decimal, floating point as %g with 6 significant digits. Returns the
+// end of the written text; a value that does not fit is written as "?".
+inline char* to_chars(char* first, char* last, const Value& value) {
+  auto [ptr, ec] = value.type == ValueType::Floating
+    ? std::to_chars(first, last, value.floating,
+                    std::chars_format::general, 6)
+    : std::to_chars(first, last, value.integer);
+  if (ec == std::errc()) return ptr;
+  if (first == last) return first;
+  *first = '?';
+  return first + 1;
+}
+
+// One reading of a resource, as handed to observers
+struct Sample {
+  uint64_t timestamp = 0;   // nanoseconds since the Unix epoch
+  uint32_t resource_id = 0;
+  Value value;
+};
+
+// Raw TscClock reading, for code that takes many samples and converts
+// them with ticks_to_timestamp() when they are written out
+inline uint64_t sample_ticks() {
+  return TscClock::instance().ticks();
+}
+
+inline uint64_t ticks_to_timestamp(uint64_t ticks) {
+  return TscClock::instance().to_wall(ticks);
+}
+
+inline uint64_t sample_timestamp() {
+  return ticks_to_timestamp(sample_ticks());
+}
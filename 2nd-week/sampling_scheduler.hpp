@@ -0,0 +1,258 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs periodic tasks from one thread, driven by a hierarchical timer
+// wheel (4 levels x 64 slots of one tick each).
+// Deadlines advance by whole periods from the previous deadline rather
+// than from the time the task ran, so cadences do not drift; periods
+// missed entirely are skipped and counted. The thread sleeps until the
+// next slot holding work and runs every task due by then in one batch.
+class SamplingScheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Task = std::function<void()>;
+
+private:
+  static constexpr unsigned SLOT_BITS = 6;
+  static constexpr uint64_t SLOTS = uint64_t(1) << SLOT_BITS;
+  static constexpr unsigned LEVELS = 4;
+  static constexpr uint64_t MAX_DELTA
+    = (uint64_t(1) << (SLOT_BITS * LEVELS)) - 1;
+
+  struct Timer {
+    Task task;
+    uint64_t period = 0;
+    uint64_t deadline = 0;
+    std::atomic<bool> active {false};   // also read by running batches
+    bool in_wheel = false;              // else due or running
+    unsigned level = 0;
+    uint64_t slot = 0;
+  };
+
+  const Clock::duration tick;
+  const Clock::time_point origin;
+  std::deque<Timer> timers;
+  std::vector<size_t> wheel[LEVELS][SLOTS];
+  std::vector<size_t> due;
+  std::vector<size_t> free_ids;
+  std::vector<size_t> batch;   // running without the lock
+  uint64_t batches = 0;        // batches finished so far
+  uint64_t now_tick = 0;
+  uint64_t fired_count = 0;
+  uint64_t missed_count = 0;
+
+  bool stopping = false;
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::condition_variable batch_done;
+  std::thread worker;
+
+  uint64_t tick_of(Clock::time_point t) const {
+    return (t - origin) / tick;
+  }
+
+  static uint64_t span(unsigned level) {
+    return uint64_t(1) << (SLOT_BITS * level);
+  }
+
+  static uint64_t slot_of(uint64_t t, unsigned level) {
+    return (t >> (SLOT_BITS * level)) & (SLOTS - 1);
+  }
+
+  // Files the timer in the wheel, or as due when its deadline has come,
+  // as it may for one cascaded down on its very tick.
+  void place(size_t id) {
+    Timer& timer = timers[id];
+    if (timer.deadline <= now_tick) {
+      timer.in_wheel = false;
+      due.push_back(id);
+      return;
+    }
+    const uint64_t delta = std::min(timer.deadline - now_tick, MAX_DELTA);
+    const uint64_t when = now_tick + delta;
+    unsigned level = 0;
+    while (level + 1 < LEVELS && delta >= span(level + 1)) ++level;
+    timer.in_wheel = true;
+    timer.level = level;
+    timer.slot = slot_of(when, level);
+    wheel[level][timer.slot].push_back(id);
+  }
+
+  void release(size_t id) {
+    Timer& timer = timers[id];
+    timer.task = nullptr;
+    timer.active = false;
+    timer.in_wheel = false;
+    free_ids.push_back(id);
+  }
+
+  // Moves one tick forward, collecting the timers that expire on it.
+  void advance() {
+    ++now_tick;
+    unsigned top = 0;
+    while (top + 1 < LEVELS && (now_tick & (span(top + 1) - 1)) == 0) ++top;
+    // Higher levels first, so their timers can land in a lower slot
+    // that is cascaded right after
+    for (unsigned level = top; level > 0; --level) {
+      auto& slot = wheel[level][slot_of(now_tick, level)];
+      std::vector<size_t> cascade;
+      cascade.swap(slot);
+      for (auto id:cascade) place(id);
+    }
+
+    // Nothing is placed back into the slot being emptied
+    auto& slot = wheel[0][slot_of(now_tick, 0)];
+    for (auto id:slot) place(id);
+    slot.clear();
+  }
+
+  // Next tick with work in level 0, or the next cascade point.
+  uint64_t next_event_tick() const {
+    const uint64_t boundary = (now_tick | (SLOTS - 1)) + 1;
+    for (uint64_t t = now_tick + 1; t < boundary; ++t)
+      if (!wheel[0][slot_of(t, 0)].empty()) return t;
+    return boundary;
+  }
+
+  void reschedule(size_t id) {
+    Timer& timer = timers[id];
+    if (!timer.active) return release(id);
+    timer.deadline += timer.period;
+    if (timer.deadline <= now_tick) {
+      const uint64_t skipped = (now_tick - timer.deadline) / timer.period + 1;
+      timer.deadline += skipped * timer.period;
+      missed_count += skipped;
+    }
+    place(id);
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock {mtx};
+    std::vector<Timer*> running;
+    while (!stopping) {
+      while (now_tick < tick_of(Clock::now())) advance();
+      if (due.empty()) {
+        const auto wake = origin + tick * next_event_tick();
+        cv.wait_until(lock, wake);
+        continue;
+      }
+
+      batch.swap(due);
+      // Drop timers removed while they were due
+      batch.erase(std::remove_if(batch.begin(), batch.end(), [this](size_t id) {
+        if (timers[id].active) return false;
+        release(id);
+        return true;
+      }), batch.end());
+      for (auto id:batch) running.push_back(&timers[id]);
+      lock.unlock();
+      size_t ran = 0;
+      // A task may remove timers later in the batch
+      for (auto timer:running) {
+        if (!timer->active.load()) continue;
+        timer->task();
+        ++ran;
+      }
+      lock.lock();
+      fired_count += ran;
+      for (auto id:batch) reschedule(id);
+      batch.clear();
+      running.clear();
+      ++batches;
+      batch_done.notify_all();
+    }
+  }
+
+public:
+  SamplingScheduler(Clock::duration tick = std::chrono::milliseconds(1))
+    : tick(tick), origin(Clock::now()) {
+    if (tick <= Clock::duration::zero())
+      throw std::invalid_argument("The tick must be positive");
+    worker = std::thread(&SamplingScheduler::run, this);
+  }
+
+  SamplingScheduler(const SamplingScheduler&) = delete;
+  SamplingScheduler& operator=(const SamplingScheduler&) = delete;
+
+  virtual ~SamplingScheduler() {
+    {
+      std::scoped_lock<std::mutex> lock {mtx};
+      stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+  }
+
+  // The first run happens one period from now.
+  size_t add(Clock::duration period, Task task) {
+    if (period <= Clock::duration::zero())
+      throw std::invalid_argument("The period must be positive");
+    std::scoped_lock<std::mutex> lock {mtx};
+    // The worker may be asleep with now_tick behind the clock
+    while (now_tick < tick_of(Clock::now())) advance();
+    const uint64_t ticks
+      = std::max<uint64_t>(1, (period + tick - Clock::duration(1)) / tick);
+    size_t id = timers.size();
+    if (free_ids.empty()) {
+      timers.emplace_back();
+    } else {
+      id = free_ids.back();
+      free_ids.pop_back();
+    }
+    timers[id].task = std::move(task);
+    timers[id].period = ticks;
+    timers[id].deadline = now_tick + ticks;
+    timers[id].active = true;
+    place(id);
+    cv.notify_all();
+    return id;
+  }
+
+  // Once remove() returns, the task neither runs nor is running, so what
+  // it uses may be destroyed. Called from a task, it cannot wait for the
+  // batch it runs in: the task may be that caller itself. The id may be
+  // handed out again by a later add().
+  void remove(size_t id) {
+    std::unique_lock<std::mutex> lock {mtx};
+    if (id >= timers.size())
+      throw std::invalid_argument("Unknown timer " + std::to_string(id));
+    Timer& timer = timers[id];
+    if (!timer.active) return;
+    if (!timer.in_wheel) {
+      // Due or running: the worker releases it
+      timer.active = false;
+      if (std::this_thread::get_id() != worker.get_id()
+          && std::find(batch.begin(), batch.end(), id) != batch.end()) {
+        const uint64_t running = batches;
+        batch_done.wait(lock, [&] { return batches != running; });
+      }
+      return;
+    }
+    auto& slot = wheel[timer.level][timer.slot];
+    *std::find(slot.begin(), slot.end(), id) = slot.back();
+    slot.pop_back();
+    release(id);
+  }
+
+  uint64_t fired() {
+    std::scoped_lock<std::mutex> lock {mtx};
+    return fired_count;
+  }
+
+  uint64_t missed() {
+    std::scoped_lock<std::mutex> lock {mtx};
+    return missed_count;
+  }
+};
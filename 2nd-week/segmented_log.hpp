@@ -0,0 +1,250 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Append-only log split into fixed-size, preallocated and memory-mapped
+// segment files named <prefix>.000000, <prefix>.000001, ...
+// Appenders reserve space with an atomic tail offset and copy into the
+// mapping. A background thread creates the next segment ahead of time and
+// trims full segments, so append() never calls open() or ftruncate().
+// Only the current and next segments stay open and mapped. If the
+// background thread fails to create a segment, the next append() throws
+// that error, and so does every append() after it.
+class SegmentedLogWriter {
+  struct Segment {
+    std::string path;
+    int fd = -1;
+    char* base = nullptr;
+    size_t size = 0;
+    std::atomic<size_t> tail {0};
+    std::atomic<size_t> end {SIZE_MAX};
+    std::atomic<size_t> writers {0};
+  };
+
+  const std::string prefix;
+  const size_t segment_size;
+  size_t sequence = 0;
+
+  // Open segments, oldest first. Finalized ones move to spare and are
+  // reused, so a stale pointer held by an appender never dangles.
+  std::deque<std::unique_ptr<Segment>> segments;
+  std::vector<std::unique_ptr<Segment>> spare;
+  std::atomic<Segment*> current {nullptr};
+  Segment* next = nullptr;
+  std::vector<Segment*> retired;
+  bool stopping = false;
+  std::exception_ptr error;        // guarded by mtx
+  std::atomic<bool> failed {false};
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::thread worker;
+
+  [[noreturn]] static void fail(const std::string& what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+  }
+
+  std::string segment_path(size_t index) const {
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), ".%06zu", index);
+    return prefix + suffix;
+  }
+
+  static void open_segment(Segment& segment) {
+    segment.fd = ::open(segment.path.c_str(),
+                        O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (segment.fd < 0) fail("open " + segment.path);
+    int err = ::posix_fallocate(segment.fd, 0, segment.size);
+    if (err != 0) {
+      errno = err;
+      fail("fallocate " + segment.path);
+    }
+    void* base = ::mmap(nullptr, segment.size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, segment.fd, 0);
+    if (base == MAP_FAILED) fail("mmap " + segment.path);
+    segment.base = static_cast<char*>(base);
+  }
+
+  Segment* create_segment() {
+    std::unique_ptr<Segment> segment;
+    size_t index;
+    {
+      std::scoped_lock<std::mutex> lock {mtx};
+      index = sequence++;
+      if (!spare.empty()) {
+        segment = std::move(spare.back());
+        spare.pop_back();
+      }
+    }
+    if (!segment) segment = std::make_unique<Segment>();
+    segment->path = segment_path(index);
+    segment->size = segment_size;
+    segment->tail.store(0);
+    segment->end.store(SIZE_MAX);
+    try {
+      open_segment(*segment);
+    } catch (...) {
+      if (segment->fd >= 0) {
+        ::close(segment->fd);
+        segment->fd = -1;
+        ::unlink(segment->path.c_str());
+      }
+      std::scoped_lock<std::mutex> lock {mtx};
+      spare.push_back(std::move(segment));
+      throw;
+    }
+
+    std::scoped_lock<std::mutex> lock {mtx};
+    segments.push_back(std::move(segment));
+    return segments.back().get();
+  }
+
+  // Unmaps a retired segment and trims the unused preallocated tail.
+  static void finalize(Segment* segment) {
+    while (segment->writers.load() != 0) std::this_thread::yield();
+    const size_t length = std::min(segment->end.load(),
+                                   std::min(segment->tail.load(),
+                                            segment->size));
+    ::munmap(segment->base, segment->size);
+    segment->base = nullptr;
+    if (::ftruncate(segment->fd, length) < 0) {
+      // Keeping the zero padding is harmless for readers
+    }
+    ::close(segment->fd);
+    segment->fd = -1;
+  }
+
+  // Moves a finalized segment from the open ones to the spares
+  void release(Segment* segment) {
+    std::scoped_lock<std::mutex> lock {mtx};
+    auto found = std::find_if(segments.begin(), segments.end(),
+                              [segment](auto& s) { return s.get() == segment; });
+    spare.push_back(std::move(*found));
+    segments.erase(found);
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock {mtx};
+    for (;;) {
+      // After a failure only retired segments are handled
+      cv.wait(lock, [this] {
+        return stopping || (next == nullptr && !error) || !retired.empty();
+      });
+      std::vector<Segment*> done;
+      done.swap(retired);
+      const bool prepare = !stopping && next == nullptr && !error;
+      if (done.empty() && !prepare) break;
+
+      lock.unlock();
+      for (auto segment:done) {
+        finalize(segment);
+        release(segment);
+      }
+      Segment* prepared = nullptr;
+      std::exception_ptr failure;
+      if (prepare) {
+        try {
+          prepared = create_segment();
+        } catch (...) {
+          failure = std::current_exception();
+        }
+      }
+      lock.lock();
+
+      if (prepared) next = prepared;
+      if (failure) {
+        error = failure;
+        failed.store(true);
+      }
+      if (prepared || failure) cv.notify_all();
+    }
+  }
+
+  void rotate(Segment* full) {
+    std::unique_lock<std::mutex> lock {mtx};
+    if (current.load() != full) return;
+    cv.wait(lock, [this] { return next != nullptr || error; });
+    if (!next) std::rethrow_exception(error);
+    current.store(next);
+    next = nullptr;
+    retired.push_back(full);
+    cv.notify_all();
+  }
+
+public:
+  SegmentedLogWriter(std::string_view prefix, size_t segment_size)
+    : prefix(prefix), segment_size(segment_size) {
+    if (segment_size == 0)
+      throw std::invalid_argument("The segment size must be positive");
+    current.store(create_segment());
+    worker = std::thread(&SegmentedLogWriter::run, this);
+  }
+
+  SegmentedLogWriter(const SegmentedLogWriter&) = delete;
+  SegmentedLogWriter& operator=(const SegmentedLogWriter&) = delete;
+
+  virtual ~SegmentedLogWriter() {
+    {
+      std::scoped_lock<std::mutex> lock {mtx};
+      stopping = true;
+      cv.notify_all();
+    }
+    worker.join();
+    finalize(current.load());
+    if (next) {
+      finalize(next);
+      ::unlink(next->path.c_str());
+    }
+  }
+
+  void append(std::string_view msg) {
+    const size_t n = msg.size();
+    if (failed.load()) {
+      std::scoped_lock<std::mutex> lock {mtx};
+      std::rethrow_exception(error);
+    }
+    if (n > segment_size)
+      throw std::invalid_argument("The message exceeds the segment size");
+    for (;;) {
+      Segment* segment = current.load();
+      segment->writers.fetch_add(1);
+      if (segment != current.load()) {
+        segment->writers.fetch_sub(1);
+        continue;
+      }
+      const size_t offset = segment->tail.fetch_add(n);
+      if (offset + n <= segment->size) {
+        std::memcpy(segment->base + offset, msg.data(), n);
+        segment->writers.fetch_sub(1);
+        return;
+      }
+      // Exactly one appender straddles the end and marks where data stops
+      if (offset <= segment->size) segment->end.store(offset);
+      segment->writers.fetch_sub(1);
+      rotate(segment);
+    }
+  }
+
+  size_t segment_count() {
+    std::scoped_lock<std::mutex> lock {mtx};
+    return sequence;
+  }
+};
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "tsc_clock.hpp"
+
+// Latency summary of one histogram, in nanoseconds
+struct LatencySummary {
+  uint64_t count = 0;
+  double mean = 0;
+  double p50 = 0;
+  double p99 = 0;
+  double p999 = 0;
+  double max = 0;
+};
+
+struct ServiceStatsSnapshot {
+  uint64_t cycles = 0;
+  uint64_t messages = 0;
+  uint64_t bytes = 0;
+  LatencySummary cycle;    // a whole notify()
+  LatencySummary format;   // sampling and formatting within it
+  // Writes per observer, in the order observers were first seen
+  std::vector<std::pair<const void*, LatencySummary>> observers;
+};
+
+inline std::ostream& operator<<(std::ostream& o, const LatencySummary& s) {
+  return o << "count " << s.count << ", mean " << s.mean << " ns, p50 "
+           << s.p50 << " ns, p99 " << s.p99 << " ns, p999 " << s.p999
+           << " ns, max " << s.max << " ns";
+}
+
+inline std::ostream& operator<<(std::ostream& o, const ServiceStatsSnapshot& s) {
+  o << "cycles " << s.cycles << ", messages " << s.messages
+    << ", bytes " << s.bytes << '\n'
+    << "  cycle:  " << s.cycle << '\n'
+    << "  format: " << s.format << '\n';
+  for (size_t i = 0; i < s.observers.size(); ++i)
+    o << "  observer #" << i << ": " << s.observers[i].second << '\n';
+  return o;
+}
+
+#ifdef LOGGING_STATS
+
+// Time stamps in raw TscClock ticks, converted to nanoseconds only
+// when a snapshot is taken.
+inline uint64_t stats_ticks() {
+  return TscClock::instance().ticks();
+}
+
+inline double stats_ns_per_tick() {
+  return TscClock::instance().ns_per_tick();
+}
+
+// Base-2 buckets with 4 linear steps each, so percentiles are within
+// 25%. Written by one thread with relaxed loads and stores (no atomic
+// read-modify-write) and read by any.
+class LatencyHistogram {
+  static constexpr int BUCKETS = 16 + 60 * 4;
+
+  std::array<std::atomic<uint64_t>, BUCKETS> counts {};
+  std::atomic<uint64_t> total {0};
+  std::atomic<uint64_t> highest {0};
+
+  static int bucket_of(uint64_t v) {
+    if (v < 16) return static_cast<int>(v);
+    const int e = 63 - __builtin_clzll(v);
+    return 16 + (e - 4) * 4 + static_cast<int>((v >> (e - 2)) & 3);
+  }
+
+  static double value_of(int bucket) {
+    if (bucket < 16) return bucket;
+    const int e = (bucket - 16) / 4 + 4;
+    const int sub = (bucket - 16) % 4;
+    return std::ldexp(1 + (sub + 0.5) / 4, e);
+  }
+
+  static void bump(std::atomic<uint64_t>& a, uint64_t n) {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+public:
+  void record(uint64_t ticks) {
+    bump(counts[bucket_of(ticks)], 1);
+    bump(total, ticks);
+    if (ticks > highest.load(std::memory_order_relaxed))
+      highest.store(ticks, std::memory_order_relaxed);
+  }
+
+  // Accumulates into a merged view: per-bucket counts, sum and max
+  void merge_into(std::vector<uint64_t>& merged, uint64_t& sum,
+                  uint64_t& max) const {
+    merged.resize(BUCKETS);
+    for (int i = 0; i < BUCKETS; ++i)
+      merged[i] += counts[i].load(std::memory_order_relaxed);
+    sum += total.load(std::memory_order_relaxed);
+    max = std::max(max, highest.load(std::memory_order_relaxed));
+  }
+
+  static LatencySummary summarize(const std::vector<uint64_t>& merged,
+                                  uint64_t sum, uint64_t max) {
+    LatencySummary s;
+    for (auto n:merged) s.count += n;
+    if (s.count == 0) return s;
+    const double scale = stats_ns_per_tick();
+    auto percentile = [&](double q) {
+      const uint64_t rank = std::max<uint64_t>(1, std::ceil(q * s.count));
+      uint64_t seen = 0;
+      for (size_t i = 0; i < merged.size(); ++i) {
+        seen += merged[i];
+        if (seen >= rank)
+          return std::min<double>(value_of(static_cast<int>(i)), max) * scale;
+      }
+      return max * scale;
+    };
+    s.mean = static_cast<double>(sum) / s.count * scale;
+    s.p50 = percentile(0.5);
+    s.p99 = percentile(0.99);
+    s.p999 = percentile(0.999);
+    s.max = max * scale;
+    return s;
+  }
+};
+
+// Counters and latency histograms for one LoggingService. Each thread
+// records into its own shard, so the hot path has no shared writes;
+// stats() merges the shards. A small thread_local cache finds the shard
+// without locking; on a miss the service looks it up by thread id, so a
+// thread has one shard per service however many services it uses.
+class ServiceStats {
+public:
+  static constexpr bool ENABLED = true;
+  static constexpr size_t MAX_OBSERVERS = 16;
+
+private:
+  struct Shard {
+    std::thread::id owner;
+    std::atomic<uint64_t> cycles {0};
+    std::atomic<uint64_t> messages {0};
+    std::atomic<uint64_t> bytes {0};
+    LatencyHistogram cycle;
+    LatencyHistogram format;
+    // The last slot collects observers beyond MAX_OBSERVERS
+    std::array<LatencyHistogram, MAX_OBSERVERS + 1> observers;
+  };
+
+  static uint64_t next_generation() {
+    static std::atomic<uint64_t> generation {0};
+    return ++generation;
+  }
+
+  const uint64_t generation = next_generation();
+  std::array<std::atomic<const void*>, MAX_OBSERVERS> observer_keys {};
+  std::mutex mtx;
+  std::deque<Shard> shards;
+
+  static void bump(std::atomic<uint64_t>& a, uint64_t n) {
+    a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+  }
+
+  Shard& shard() {
+    // Keyed by generation, not address, so a new service at the address
+    // of a destroyed one never sees its shards
+    struct Cached {
+      uint64_t generation = 0;
+      Shard* shard = nullptr;
+    };
+    thread_local std::array<Cached, 4> cache;
+    for (auto& c:cache)
+      if (c.generation == generation) return *c.shard;
+
+    const auto self = std::this_thread::get_id();
+    Shard* found = nullptr;
+    {
+      std::scoped_lock<std::mutex> lock {mtx};
+      for (auto& s:shards)
+        if (s.owner == self) found = &s;
+      if (!found) {
+        found = &shards.emplace_back();
+        found->owner = self;
+      }
+    }
+    std::move_backward(cache.begin(), cache.end() - 1, cache.end());
+    cache[0] = Cached{generation, found};
+    return *found;
+  }
+
+  size_t observer_slot(const void* observer) {
+    for (size_t i = 0; i < MAX_OBSERVERS; ++i) {
+      const void* key = observer_keys[i].load(std::memory_order_acquire);
+      if (key == observer) return i;
+      if (key == nullptr) {
+        if (observer_keys[i].compare_exchange_strong(key, observer))
+          return i;
+        if (key == observer) return i;
+      }
+    }
+    return MAX_OBSERVERS;
+  }
+
+public:
+  using Ticks = uint64_t;
+
+  ServiceStats() {
+    stats_ns_per_tick();
+  }
+
+  ServiceStats(const ServiceStats&) = delete;
+  ServiceStats& operator=(const ServiceStats&) = delete;
+
+  Ticks now() const {
+    return stats_ticks();
+  }
+
+  void cycle(Ticks begin, Ticks formatted, Ticks end) {
+    Shard& s = shard();
+    bump(s.cycles, 1);
+    s.format.record(formatted - begin);
+    s.cycle.record(end - begin);
+  }
+
+  void message(size_t bytes) {
+    Shard& s = shard();
+    bump(s.messages, 1);
+    bump(s.bytes, bytes);
+  }
+
+  void write(const void* observer, Ticks begin, Ticks end) {
+    shard().observers[observer_slot(observer)].record(end - begin);
+  }
+
+  ServiceStatsSnapshot stats() {
+    ServiceStatsSnapshot snapshot;
+    std::vector<uint64_t> cycle, format;
+    uint64_t cycle_sum = 0, cycle_max = 0, format_sum = 0, format_max = 0;
+    std::array<std::vector<uint64_t>, MAX_OBSERVERS + 1> observers;
+    std::array<uint64_t, MAX_OBSERVERS + 1> sums {}, maxes {};
+
+    std::scoped_lock<std::mutex> lock {mtx};
+    for (auto& s:shards) {
+      snapshot.cycles += s.cycles.load(std::memory_order_relaxed);
+      snapshot.messages += s.messages.load(std::memory_order_relaxed);
+      snapshot.bytes += s.bytes.load(std::memory_order_relaxed);
+      s.cycle.merge_into(cycle, cycle_sum, cycle_max);
+      s.format.merge_into(format, format_sum, format_max);
+      for (size_t i = 0; i <= MAX_OBSERVERS; ++i)
+        s.observers[i].merge_into(observers[i], sums[i], maxes[i]);
+    }
+    snapshot.cycle = LatencyHistogram::summarize(cycle, cycle_sum, cycle_max);
+    snapshot.format
+      = LatencyHistogram::summarize(format, format_sum, format_max);
+    for (size_t i = 0; i <= MAX_OBSERVERS; ++i) {
+      const void* key = i < MAX_OBSERVERS
+        ? observer_keys[i].load(std::memory_order_acquire) : nullptr;
+      auto summary
+        = LatencyHistogram::summarize(observers[i], sums[i], maxes[i]);
+      if (summary.count > 0) snapshot.observers.emplace_back(key, summary);
+    }
+    return snapshot;
+  }
+};
+
+#else
+
+// Disabled: every call is an empty inline function and vanishes.
+class ServiceStats {
+public:
+  static constexpr bool ENABLED = false;
+
+  struct Ticks {};
+
+  Ticks now() const {
+    return Ticks();
+  }
+
+  void cycle(Ticks, Ticks, Ticks) {
+  }
+
+  void message(size_t) {
+  }
+
+  void write(const void*, Ticks, Ticks) {
+  }
+
+  ServiceStatsSnapshot stats() {
+    return ServiceStatsSnapshot();
+  }
+};
+
+#endif
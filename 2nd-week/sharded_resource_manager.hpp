@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "resource_manager.hpp"
+
+// Resources hash-partitioned by name over independent ResourceManagers,
+// so each shard can be walked by its own thread and an update copies
+// only one shard. Shard i hands out ids i, i + n, i + 2n, ... so ids stay
+// unique across shards.
+template <typename T>
+class ShardedResourceManager {
+  std::vector<std::unique_ptr<ResourceManager<T>>> shards;
+
+  ResourceManager<T>& shard_of(std::string_view name) const {
+    return *shards[std::hash<std::string_view>()(name) % shards.size()];
+  }
+
+public:
+  ShardedResourceManager(size_t shard_count) {
+    if (shard_count == 0 || shard_count > UINT32_MAX)
+      throw std::invalid_argument("Invalid shard count");
+    const auto stride = static_cast<uint32_t>(shard_count);
+    for (uint32_t i = 0; i < stride; ++i)
+      shards.push_back(std::make_unique<ResourceManager<T>>(i, stride));
+  }
+
+  void add(std::string_view name, T& resource) {
+    shard_of(name).add(name, resource);
+  }
+
+  void erase(std::string_view name) {
+    shard_of(name).erase(name);
+  }
+
+  std::optional<ResourceEntry<T>> entry(std::string_view name) const {
+    return shard_of(name).entry(name);
+  }
+
+  std::optional<uint32_t> id(std::string_view name) const {
+    return shard_of(name).id(name);
+  }
+
+  size_t shard_count() const {
+    return shards.size();
+  }
+
+  const ResourceManager<T>& shard(size_t i) const {
+    return *shards.at(i);
+  }
+};
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "sample.hpp"
+
+// Single-producer, multi-consumer broadcast ring in POSIX shared memory.
+// Slot n of the stream lives at index n % slot_count and is guarded by a
+// sequence lock: the writer marks it odd while copying and stores
+// 2 * (n + 1) once it is complete. The writer never waits for readers;
+// a reader that falls more than slot_count records behind skips ahead
+// and counts the loss. Polling is plain loads, without syscalls.
+// A segment has one writer at a time; a new writer replaces the segment
+// of a dead one rather than reusing it under mapped readers.
+struct ShmRecord {
+  static constexpr size_t TEXT_SIZE = 96;
+  static constexpr uint8_t TEXT_ONLY = 1;  // no sample; ignore resource_id
+
+  uint64_t timestamp;
+  uint32_t resource_id;
+  uint8_t type;
+  uint8_t flags;
+  uint16_t size;
+  uint64_t value;   // as Value::bits()
+  char text[TEXT_SIZE];
+
+  Sample sample() const {
+    Sample s;
+    s.timestamp = timestamp;
+    s.resource_id = resource_id;
+    s.value = Value::from_bits(static_cast<ValueType>(type), value);
+    return s;
+  }
+
+  bool has_sample() const {
+    return !(flags & TEXT_ONLY);
+  }
+
+  std::string_view message() const {
+    return std::string_view(text, size);
+  }
+};
+
+struct alignas(64) ShmSlot {
+  std::atomic<uint64_t> seq;
+  ShmRecord record;
+};
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+struct ShmRingHeader {
+  static constexpr uint64_t MAGIC = 0x474e495253524853ull;  // "SHRSRING"
+  static constexpr uint32_t VERSION = 2;
+
+  uint64_t magic;
+  uint32_t version;
+  uint32_t slot_count;
+  uint32_t slot_size;
+  int32_t writer_pid;
+  alignas(64) std::atomic<uint64_t> head;  // records published so far
+};
+
+class ShmRegion {
+protected:
+  std::string name;
+  int fd = -1;
+  void* base = MAP_FAILED;
+  size_t size = 0;
+
+  [[noreturn]] void fail(const char* what) {
+    throw std::runtime_error(
+      std::string(what) + " " + name + ": " + std::strerror(errno));
+  }
+
+  ShmRingHeader* header() const {
+    return static_cast<ShmRingHeader*>(base);
+  }
+
+  ShmSlot* slots() const {
+    return reinterpret_cast<ShmSlot*>(
+      static_cast<char*>(base) + sizeof(ShmRingHeader));
+  }
+
+  ShmRegion(std::string_view name)
+    : name(name) {
+  }
+
+  virtual ~ShmRegion() {
+    if (base != MAP_FAILED) ::munmap(base, size);
+    if (fd >= 0) ::close(fd);
+  }
+
+public:
+  ShmRegion(const ShmRegion&) = delete;
+  ShmRegion& operator=(const ShmRegion&) = delete;
+};
+
+class ShmRingWriter : public ShmRegion {
+  uint64_t next = 0;
+
+  // Whether an existing segment still has its writer. Ours are removed
+  // only when that writer is gone; anything else is left alone.
+  bool has_live_writer() {
+    const int existing = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (existing < 0) {
+      if (errno == ENOENT) return false;
+      fail("shm_open");
+    }
+    struct stat st;
+    ShmRingHeader h {};
+    const bool ours = ::fstat(existing, &st) == 0
+      && size_t(st.st_size) >= sizeof(h)
+      && ::pread(existing, &h, sizeof(h), 0) == ssize_t(sizeof(h))
+      && h.magic == ShmRingHeader::MAGIC
+      && h.version == ShmRingHeader::VERSION;
+    ::close(existing);
+    if (!ours)
+      throw std::runtime_error(name + " exists and is not a resource ring");
+    return ::kill(h.writer_pid, 0) == 0 || errno == EPERM;
+  }
+
+  void put(uint64_t timestamp, uint32_t resource_id, uint8_t type,
+           uint8_t flags, uint64_t value, std::string_view msg) {
+    ShmSlot& slot = slots()[next % header()->slot_count];
+    slot.seq.store(2 * next + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ShmRecord& r = slot.record;
+    r.timestamp = timestamp;
+    r.resource_id = resource_id;
+    r.type = type;
+    r.flags = flags;
+    r.value = value;
+    r.size = static_cast<uint16_t>(std::min(msg.size(), ShmRecord::TEXT_SIZE));
+    std::memcpy(r.text, msg.data(), r.size);
+
+    slot.seq.store(2 * (next + 1), std::memory_order_release);
+    ++next;
+    header()->head.store(next, std::memory_order_release);
+  }
+
+public:
+  // name follows shm_open(), e.g. "/resource-ring". Throws if another
+  // live process is writing to it.
+  ShmRingWriter(std::string_view name, uint32_t slot_count = 4096)
+    : ShmRegion(name) {
+    if (slot_count == 0)
+      throw std::invalid_argument("The slot count must be positive");
+    size = sizeof(ShmRingHeader) + sizeof(ShmSlot) * slot_count;
+    // Never truncate in place: readers may still map a dead writer's
+    // segment, so it is unlinked and a fresh one created instead
+    for (int attempt = 0; fd < 0; ++attempt) {
+      fd = ::shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+      if (fd >= 0) break;
+      if (errno != EEXIST || attempt == 2) fail("shm_open");
+      if (has_live_writer())
+        throw std::runtime_error(this->name + " already has a live writer");
+      if (::shm_unlink(this->name.c_str()) < 0 && errno != ENOENT)
+        fail("shm_unlink");
+    }
+    if (::ftruncate(fd, size) < 0) fail("ftruncate");
+    base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) fail("mmap");
+
+    ShmRingHeader* h = header();
+    h->head.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < slot_count; ++i)
+      slots()[i].seq.store(0, std::memory_order_relaxed);
+    h->slot_count = slot_count;
+    h->slot_size = sizeof(ShmSlot);
+    h->writer_pid = ::getpid();
+    h->version = ShmRingHeader::VERSION;
+    std::atomic_thread_fence(std::memory_order_release);
+    h->magic = ShmRingHeader::MAGIC;
+  }
+
+  virtual ~ShmRingWriter() {
+    ::shm_unlink(name.c_str());
+  }
+
+  void publish(const Sample& sample, std::string_view msg) {
+    put(sample.timestamp, sample.resource_id,
+        static_cast<uint8_t>(sample.value.type), 0, sample.value.bits(), msg);
+  }
+
+  // Free-form text that belongs to no resource
+  void publish_text(uint64_t timestamp, std::string_view msg) {
+    put(timestamp, 0, 0, ShmRecord::TEXT_ONLY, 0, msg);
+  }
+};
+
+class ShmRingReader : public ShmRegion {
+  uint64_t next;
+  uint64_t lost_count = 0;
+
+public:
+  // Starts at the newest record; pass from_start to replay what is
+  // still in the ring.
+  ShmRingReader(std::string_view name, bool from_start = false)
+    : ShmRegion(name) {
+    fd = ::shm_open(this->name.c_str(), O_RDONLY, 0);
+    if (fd < 0) fail("shm_open");
+    struct stat st;
+    if (::fstat(fd, &st) < 0) fail("fstat");
+    size = st.st_size;
+    if (size < sizeof(ShmRingHeader))
+      throw std::runtime_error(
+        "Shared memory " + this->name + " is too small");
+    base = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) fail("mmap");
+
+    const ShmRingHeader* h = header();
+    if (h->magic != ShmRingHeader::MAGIC
+        || h->version != ShmRingHeader::VERSION
+        || h->slot_size != sizeof(ShmSlot)
+        || size < sizeof(ShmRingHeader) + sizeof(ShmSlot) * h->slot_count)
+      throw std::runtime_error(
+        this->name + " is not a compatible resource ring");
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    const uint64_t head = h->head.load(std::memory_order_acquire);
+    next = from_start && head > h->slot_count ? head - h->slot_count
+         : from_start ? 0 : head;
+  }
+
+  // Copies the next record into out; false when there is nothing new.
+  bool poll(ShmRecord& out) {
+    const ShmRingHeader* h = header();
+    for (;;) {
+      const uint64_t head = h->head.load(std::memory_order_acquire);
+      if (next >= head) return false;
+      if (head - next > h->slot_count) {
+        lost_count += head - h->slot_count - next;
+        next = head - h->slot_count;
+      }
+
+      const ShmSlot& slot = slots()[next % h->slot_count];
+      const uint64_t before = slot.seq.load(std::memory_order_acquire);
+      if (before == 2 * (next + 1)) {
+        std::memcpy(&out, &slot.record, sizeof(out));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == before) {
+          ++next;
+          return true;
+        }
+      }
+      // Overwritten while we looked: count it and move on
+      ++lost_count;
+      ++next;
+    }
+  }
+
+  uint64_t lost() const {
+    return lost_count;
+  }
+};
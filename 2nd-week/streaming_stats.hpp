@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Log-linear histogram in the spirit of HDR histograms: 64 binary orders
+// of magnitude (2^-20 .. 2^44) with 32 linear sub-buckets each, so any
+// percentile is within about 3% of the true value. Recording is O(1).
+class LogHistogram {
+  static constexpr int MIN_EXPONENT = -20;
+  static constexpr int EXPONENTS = 64;
+  static constexpr int SUB_BUCKETS = 32;
+  static constexpr int BUCKETS = 1 + EXPONENTS * SUB_BUCKETS;
+
+  std::array<uint32_t, BUCKETS> counts {};
+  uint64_t total = 0;
+  double sum = 0;
+  double lowest = std::numeric_limits<double>::max();
+  double highest = std::numeric_limits<double>::lowest();
+
+  // Bucket 0 holds zero and negative values
+  static int bucket_of(double v) {
+    if (!(v > 0)) return 0;
+    int exponent;
+    const double mantissa = std::frexp(v, &exponent);
+    const int e = std::clamp(exponent - MIN_EXPONENT, 0, EXPONENTS - 1);
+    const int sub = std::min(static_cast<int>((mantissa - 0.5) * 2 * SUB_BUCKETS),
+                             SUB_BUCKETS - 1);
+    return 1 + e * SUB_BUCKETS + sub;
+  }
+
+  static double value_of(int bucket) {
+    if (bucket == 0) return 0;
+    const int e = (bucket - 1) / SUB_BUCKETS;
+    const int sub = (bucket - 1) % SUB_BUCKETS;
+    const double mantissa = 0.5 + (sub + 0.5) / (2 * SUB_BUCKETS);
+    return std::ldexp(mantissa, e + MIN_EXPONENT);
+  }
+
+public:
+  void record(double v) {
+    ++counts[bucket_of(v)];
+    ++total;
+    sum += v;
+    lowest = std::min(lowest, v);
+    highest = std::max(highest, v);
+  }
+
+  void reset() {
+    counts.fill(0);
+    total = 0;
+    sum = 0;
+    lowest = std::numeric_limits<double>::max();
+    highest = std::numeric_limits<double>::lowest();
+  }
+
+  uint64_t count() const {
+    return total;
+  }
+
+  double min() const {
+    return total ? lowest : 0;
+  }
+
+  double max() const {
+    return total ? highest : 0;
+  }
+
+  double mean() const {
+    return total ? sum / total : 0;
+  }
+
+  // q in [0, 1]
+  double percentile(double q) const {
+    if (total == 0) return 0;
+    const uint64_t rank = std::max<uint64_t>(1, std::ceil(q * total));
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < BUCKETS; ++bucket) {
+      seen += counts[bucket];
+      if (seen >= rank) return std::clamp(value_of(bucket), lowest, highest);
+    }
+    return highest;
+  }
+};
+
+struct WindowSummary {
+  std::chrono::nanoseconds window;
+  uint64_t start;   // nanoseconds since the Unix epoch
+  uint64_t count;
+  double min;
+  double mean;
+  double p50;
+  double p95;
+  double p99;
+  double max;
+};
+
+// Tumbling windows aligned to multiples of their length. A window is
+// summarized when the first sample of the next one arrives, or on flush().
+// flush() closes the open windows early: samples that still fall in a
+// flushed window are dropped, so no window is summarized twice.
+class WindowedStats {
+  struct Window {
+    std::chrono::nanoseconds length;
+    uint64_t start = 0;
+    uint64_t closed = 0;      // samples before this were flushed
+    LogHistogram histogram;
+  };
+
+  std::vector<Window> windows;
+
+  static WindowSummary summarize(const Window& w) {
+    const auto& h = w.histogram;
+    return WindowSummary{w.length, w.start, h.count(), h.min(), h.mean(),
+                         h.percentile(0.5), h.percentile(0.95),
+                         h.percentile(0.99), h.max()};
+  }
+
+public:
+  WindowedStats(const std::vector<std::chrono::nanoseconds>& lengths) {
+    for (auto length:lengths) {
+      if (length <= std::chrono::nanoseconds::zero())
+        throw std::invalid_argument("Window lengths must be positive");
+      windows.emplace_back();
+      windows.back().length = length;
+    }
+  }
+
+  template <typename Emit>
+  void record(uint64_t timestamp, double value, Emit&& emit) {
+    for (auto& w:windows) {
+      const uint64_t length = w.length.count();
+      if (timestamp < w.closed) continue;
+      const uint64_t start = timestamp - timestamp % length;
+      if (start != w.start) {
+        if (w.histogram.count() > 0) emit(summarize(w));
+        w.histogram.reset();
+        w.start = start;
+      }
+      w.histogram.record(value);
+    }
+  }
+
+  template <typename Emit>
+  void flush(Emit&& emit) {
+    for (auto& w:windows) {
+      if (w.histogram.count() == 0) continue;
+      emit(summarize(w));
+      w.histogram.reset();
+      w.closed = w.start + w.length.count();
+    }
+  }
+};
@@ -0,0 +1,383 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+// Bits appended most significant first into 64-bit words
+class BitWriter {
+  std::vector<uint64_t> words;
+  size_t count = 0;
+
+public:
+  // Low n bits of value, n in [0, 64]
+  void write(uint64_t value, unsigned n) {
+    if (n == 0) return;
+    if (n < 64) value &= (uint64_t(1) << n) - 1;
+    const unsigned offset = count % 64;
+    if (offset == 0) words.push_back(0);
+    const unsigned room = 64 - offset;
+    if (n <= room) {
+      words.back() |= value << (room - n);
+    } else {
+      words.back() |= value >> (n - room);
+      words.push_back(value << (64 - (n - room)));
+    }
+    count += n;
+  }
+
+  size_t bits() const {
+    return count;
+  }
+
+  void reserve(size_t bits) {
+    words.reserve((bits + 63) / 64);
+  }
+
+  // Bytes allocated, which may exceed the bytes written
+  size_t capacity() const {
+    return words.capacity() * sizeof(uint64_t);
+  }
+
+  const std::vector<uint64_t>& data() const {
+    return words;
+  }
+};
+
+class BitReader {
+  const std::vector<uint64_t>& words;
+  size_t position = 0;
+
+public:
+  BitReader(const std::vector<uint64_t>& words)
+    : words(words) {
+  }
+
+  uint64_t read(unsigned n) {
+    if (n == 0) return 0;
+    const size_t word = position / 64;
+    const unsigned offset = position % 64;
+    const unsigned room = 64 - offset;
+    uint64_t value = (words[word] << offset) >> (64 - n);
+    if (n > room) value |= words[word + 1] >> (64 - (n - room));
+    position += n;
+    return value;
+  }
+
+  bool bit() {
+    return read(1) != 0;
+  }
+};
+
+// Gorilla encoding (Pelkonen et al., VLDB'15) of (timestamp, double)
+// pairs. Timestamps are stored as delta-of-delta with bucket widths
+// chosen for nanosecond clocks sampled at up to a few kHz; values as the
+// XOR with the previous value, reusing the previous window of meaningful
+// bits when the new one fits into it. The first point is stored raw, so
+// every chunk decodes on its own.
+class GorillaChunk {
+  BitWriter stream;
+  uint32_t points = 0;
+  uint64_t last_timestamp = 0;
+  int64_t last_delta = 0;
+  uint64_t last_value = 0;
+  unsigned leading = 0;
+  unsigned trailing = 0;
+  bool window = false;
+
+  static bool fits(int64_t v, unsigned bits) {
+    const int64_t limit = int64_t(1) << (bits - 1);
+    return v >= -limit && v < limit;
+  }
+
+  void write_timestamp(uint64_t timestamp) {
+    const int64_t delta = static_cast<int64_t>(timestamp - last_timestamp);
+    const int64_t dod = delta - last_delta;
+    if (dod == 0) {
+      stream.write(0b0, 1);
+    } else if (fits(dod, 14)) {
+      stream.write(0b10, 2);
+      stream.write(dod, 14);
+    } else if (fits(dod, 20)) {
+      stream.write(0b110, 3);
+      stream.write(dod, 20);
+    } else if (fits(dod, 32)) {
+      stream.write(0b1110, 4);
+      stream.write(dod, 32);
+    } else {
+      stream.write(0b1111, 4);
+      stream.write(dod, 64);
+    }
+    last_delta = delta;
+    last_timestamp = timestamp;
+  }
+
+  void write_value(uint64_t bits) {
+    const uint64_t x = bits ^ last_value;
+    last_value = bits;
+    if (x == 0) {
+      stream.write(0b0, 1);
+      return;
+    }
+    const unsigned lead = std::min(__builtin_clzll(x), 31);
+    const unsigned trail = __builtin_ctzll(x);
+    if (window && lead >= leading && trail >= trailing) {
+      stream.write(0b10, 2);
+      stream.write(x >> trailing, 64 - leading - trailing);
+      return;
+    }
+    const unsigned meaningful = 64 - lead - trail;
+    stream.write(0b11, 2);
+    stream.write(lead, 5);
+    stream.write(meaningful - 1, 6);
+    stream.write(x >> trail, meaningful);
+    leading = lead;
+    trailing = trail;
+    window = true;
+  }
+
+public:
+  void append(uint64_t timestamp, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if (points == 0) {
+      stream.write(timestamp, 64);
+      stream.write(bits, 64);
+      last_timestamp = timestamp;
+      last_value = bits;
+    } else {
+      write_timestamp(timestamp);
+      write_value(bits);
+    }
+    ++points;
+  }
+
+  uint32_t size() const {
+    return points;
+  }
+
+  size_t bytes() const {
+    return stream.data().size() * sizeof(uint64_t);
+  }
+
+  size_t bits() const {
+    return stream.bits();
+  }
+
+  void reserve(size_t bytes) {
+    stream.reserve(bytes * 8);
+  }
+
+  size_t allocated_bytes() const {
+    return stream.capacity();
+  }
+
+  // Calls f(timestamp, value) for every point in order
+  template <typename F>
+  void decode(F&& f) const {
+    if (points == 0) return;
+    BitReader in(stream.data());
+    uint64_t timestamp = in.read(64);
+    uint64_t bits = in.read(64);
+    int64_t delta = 0;
+    unsigned lead = 0, trail = 0;
+    auto emit = [&] {
+      double value;
+      std::memcpy(&value, &bits, sizeof(value));
+      f(timestamp, value);
+    };
+    auto signed_bits = [&](unsigned n) {
+      const uint64_t raw = in.read(n);
+      if (n == 64) return static_cast<int64_t>(raw);
+      const uint64_t sign = uint64_t(1) << (n - 1);
+      return static_cast<int64_t>((raw ^ sign) - sign);
+    };
+
+    emit();
+    for (uint32_t i = 1; i < points; ++i) {
+      int64_t dod = 0;
+      if (in.bit()) {
+        if (!in.bit()) dod = signed_bits(14);
+        else if (!in.bit()) dod = signed_bits(20);
+        else if (!in.bit()) dod = signed_bits(32);
+        else dod = signed_bits(64);
+      }
+      delta += dod;
+      timestamp += delta;
+
+      if (in.bit()) {
+        if (in.bit()) {
+          lead = in.read(5);
+          trail = 64 - lead - (in.read(6) + 1);
+        }
+        bits ^= in.read(64 - lead - trail) << trail;
+      }
+      emit();
+    }
+  }
+};
+
+struct TimeSeriesOptions {
+  size_t chunk_bytes = 4096;
+  uint64_t retention = 0;   // nanoseconds of history to keep; 0 keeps all
+};
+
+struct TimeSeriesAggregate {
+  uint64_t start;           // bucket start, a multiple of the step
+  uint64_t count;
+  double min;
+  double max;
+  double mean;
+};
+
+// Per-resource compressed series for the samples of a LoggingService.
+// Each series is a list of fixed-size Gorilla chunks that also keep
+// their time span and min/max/sum, so aggregates over whole chunks need
+// no decoding. Appends take an exclusive lock, queries a shared one.
+class TimeSeriesStore {
+  struct Chunk {
+    GorillaChunk points;
+    uint64_t first_timestamp = std::numeric_limits<uint64_t>::max();
+    uint64_t last_timestamp = 0;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+    double sum = 0;
+
+    bool overlaps(uint64_t from, uint64_t to) const {
+      return first_timestamp <= to && last_timestamp >= from;
+    }
+  };
+  using Series = std::deque<Chunk>;
+
+  const TimeSeriesOptions options;
+  std::vector<std::unique_ptr<Series>> series;
+  mutable std::shared_mutex mtx;
+
+  const Series* find(uint32_t resource_id) const {
+    return resource_id < series.size() ? series[resource_id].get() : nullptr;
+  }
+
+  struct Accumulator {
+    uint64_t count = 0;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+    double sum = 0;
+
+    void add(double v) {
+      ++count;
+      min = std::min(min, v);
+      max = std::max(max, v);
+      sum += v;
+    }
+  };
+
+public:
+  TimeSeriesStore(const TimeSeriesOptions& options = TimeSeriesOptions())
+    : options(options) {
+  }
+
+  void append(uint32_t resource_id, uint64_t timestamp, double value) {
+    std::unique_lock<std::shared_mutex> lock {mtx};
+    if (series.size() <= resource_id) series.resize(resource_id + 1);
+    auto& s = series[resource_id];
+    if (!s) s = std::make_unique<Series>();
+    if (s->empty() || s->back().points.bits() >= options.chunk_bytes * 8) {
+      // A chunk is sealed at the first point past chunk_bytes, and one
+      // point takes at most 145 bits, so this is the last allocation
+      s->emplace_back();
+      s->back().points.reserve(options.chunk_bytes + 3 * sizeof(uint64_t));
+    }
+
+    Chunk& chunk = s->back();
+    chunk.points.append(timestamp, value);
+    chunk.first_timestamp = std::min(chunk.first_timestamp, timestamp);
+    chunk.last_timestamp = std::max(chunk.last_timestamp, timestamp);
+    chunk.min = std::min(chunk.min, value);
+    chunk.max = std::max(chunk.max, value);
+    chunk.sum += value;
+
+    if (options.retention > 0 && timestamp > options.retention) {
+      const uint64_t horizon = timestamp - options.retention;
+      while (s->size() > 1 && s->front().last_timestamp < horizon)
+        s->pop_front();
+    }
+  }
+
+  // Calls f(timestamp, value) for the points of resource_id in [from, to]
+  template <typename F>
+  void scan(uint32_t resource_id, uint64_t from, uint64_t to, F&& f) const {
+    std::shared_lock<std::shared_mutex> lock {mtx};
+    const Series* s = find(resource_id);
+    if (!s) return;
+    for (auto& chunk:*s) {
+      if (!chunk.overlaps(from, to)) continue;
+      chunk.points.decode([&](uint64_t timestamp, double value) {
+        if (timestamp >= from && timestamp <= to) f(timestamp, value);
+      });
+    }
+  }
+
+  // One aggregate per non-empty step-aligned bucket of [from, to]
+  std::vector<TimeSeriesAggregate> downsample(uint32_t resource_id,
+                                              uint64_t from, uint64_t to,
+                                              uint64_t step) const {
+    std::map<uint64_t, Accumulator> buckets;
+    {
+      std::shared_lock<std::shared_mutex> lock {mtx};
+      const Series* s = find(resource_id);
+      if (!s || step == 0) return {};
+      for (auto& chunk:*s) {
+        if (!chunk.overlaps(from, to)) continue;
+        const uint64_t bucket = chunk.first_timestamp
+                                - chunk.first_timestamp % step;
+        if (chunk.first_timestamp >= from && chunk.last_timestamp <= to
+            && chunk.last_timestamp < bucket + step) {
+          auto& acc = buckets[bucket];
+          acc.count += chunk.points.size();
+          acc.min = std::min(acc.min, chunk.min);
+          acc.max = std::max(acc.max, chunk.max);
+          acc.sum += chunk.sum;
+          continue;
+        }
+        chunk.points.decode([&](uint64_t timestamp, double value) {
+          if (timestamp >= from && timestamp <= to)
+            buckets[timestamp - timestamp % step].add(value);
+        });
+      }
+    }
+
+    std::vector<TimeSeriesAggregate> result;
+    result.reserve(buckets.size());
+    for (auto& [start, acc]:buckets)
+      result.push_back(TimeSeriesAggregate{start, acc.count, acc.min,
+                                           acc.max, acc.sum / acc.count});
+    return result;
+  }
+
+  size_t points() const {
+    std::shared_lock<std::shared_mutex> lock {mtx};
+    size_t n = 0;
+    for (auto& s:series)
+      if (s)
+        for (auto& chunk:*s) n += chunk.points.size();
+    return n;
+  }
+
+  // Allocated chunk bytes plus chunk bookkeeping
+  size_t memory_bytes() const {
+    std::shared_lock<std::shared_mutex> lock {mtx};
+    size_t n = 0;
+    for (auto& s:series)
+      if (s)
+        for (auto& chunk:*s)
+          n += chunk.points.allocated_bytes() + sizeof(Chunk);
+    return n;
+  }
+};
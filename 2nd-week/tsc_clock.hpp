@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+// Timestamps for the logging path. ticks() is a bare rdtsc when the CPU
+// has an invariant TSC, and CLOCK_MONOTONIC through the vDSO otherwise;
+// to_wall() turns ticks into nanoseconds since the Unix epoch and is
+// meant to run when records are written out, not when they are taken.
+//
+// The tick rate is calibrated against CLOCK_MONOTONIC at startup and
+// refitted over the whole run whenever RECALIBRATE_NS has passed, which
+// corrects drift and also follows steps of the wall clock. Conversion
+// parameters are published under a sequence lock, so readers never block.
+class TscClock {
+public:
+  static constexpr uint64_t CALIBRATE_NS = 2000000;
+  static constexpr uint64_t RECALIBRATE_NS = 1000000000;
+
+private:
+  const bool tsc;
+  uint64_t origin_ticks = 0;
+  uint64_t origin_monotonic = 0;
+
+  // Guarded by seq: wall = anchor_wall + (ticks - anchor_ticks) * mult
+  // with mult in nanoseconds per tick as 32.32 fixed point
+  std::atomic<uint64_t> seq {0};
+  std::atomic<uint64_t> anchor_ticks {0};
+  std::atomic<uint64_t> anchor_wall {0};
+  std::atomic<uint64_t> mult {0};
+  std::atomic<uint64_t> next_calibration {0};
+  std::mutex calibrate_mtx;
+
+  static uint64_t read_clock(clockid_t id) {
+    timespec ts;
+    ::clock_gettime(id, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  static bool invariant_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned a, b, c, d;
+    if (!__get_cpuid(0x80000007, &a, &b, &c, &d)) return false;
+    return (d >> 8) & 1;
+#else
+    return false;
+#endif
+  }
+
+  // A tick reading and the monotonic time it was taken at, from the
+  // tightest of a few bracketing attempts
+  void pair(uint64_t& ticks_out, uint64_t& monotonic_out) const {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 5; ++i) {
+      const uint64_t before = read_clock(CLOCK_MONOTONIC);
+      const uint64_t t = ticks();
+      const uint64_t after = read_clock(CLOCK_MONOTONIC);
+      if (after - before < best) {
+        best = after - before;
+        ticks_out = t;
+        monotonic_out = before + (after - before) / 2;
+      }
+    }
+  }
+
+  void calibrate() {
+    uint64_t t = 0, m = 0;
+    pair(t, m);
+    const uint64_t wall_offset = read_clock(CLOCK_REALTIME)
+                                 - read_clock(CLOCK_MONOTONIC);
+    uint64_t ratio = uint64_t(1) << 32;
+    if (tsc && t != origin_ticks)
+      ratio = static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(m - origin_monotonic) << 32)
+        / (t - origin_ticks));
+
+    const uint64_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    anchor_ticks.store(t, std::memory_order_relaxed);
+    anchor_wall.store(m + wall_offset, std::memory_order_relaxed);
+    mult.store(ratio, std::memory_order_relaxed);
+    seq.store(s + 2, std::memory_order_release);
+
+    const uint64_t period = static_cast<uint64_t>(
+      (static_cast<unsigned __int128>(RECALIBRATE_NS) << 32) / ratio);
+    next_calibration.store(t + period, std::memory_order_relaxed);
+  }
+
+  void maybe_recalibrate(uint64_t now) {
+    if (now < next_calibration.load(std::memory_order_relaxed)) return;
+    std::unique_lock<std::mutex> lock {calibrate_mtx, std::try_to_lock};
+    if (!lock || now < next_calibration.load(std::memory_order_relaxed))
+      return;
+    calibrate();
+  }
+
+public:
+  TscClock(bool use_tsc = true)
+    : tsc(use_tsc && invariant_tsc()) {
+    pair(origin_ticks, origin_monotonic);
+    if (tsc) {
+      // Spin rather than sleep, so startup costs a couple of milliseconds
+      while (read_clock(CLOCK_MONOTONIC) - origin_monotonic < CALIBRATE_NS) {
+      }
+    }
+    calibrate();
+  }
+
+  TscClock(const TscClock&) = delete;
+  TscClock& operator=(const TscClock&) = delete;
+
+  static TscClock& instance() {
+    static TscClock clock;
+    return clock;
+  }
+
+  bool uses_tsc() const {
+    return tsc;
+  }
+
+  uint64_t ticks() const {
+#if defined(__x86_64__) || defined(__i386__)
+    if (tsc) return __rdtsc();
+#endif
+    return read_clock(CLOCK_MONOTONIC);
+  }
+
+  double ns_per_tick() const {
+    return static_cast<double>(mult.load(std::memory_order_relaxed))
+           / (uint64_t(1) << 32);
+  }
+
+  // Nanoseconds since the Unix epoch; ticks may predate the latest
+  // calibration.
+  uint64_t to_wall(uint64_t ticks) {
+    maybe_recalibrate(ticks);
+    uint64_t s, t, w, m;
+    do {
+      s = seq.load(std::memory_order_acquire);
+      t = anchor_ticks.load(std::memory_order_relaxed);
+      w = anchor_wall.load(std::memory_order_relaxed);
+      m = mult.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((s & 1) || s != seq.load(std::memory_order_relaxed));
+    const __int128 delta = static_cast<int64_t>(ticks - t);
+    return w + static_cast<int64_t>((delta * m) >> 32);
+  }
+};
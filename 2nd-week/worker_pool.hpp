@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads running parallel loops. run(count, f) calls f(i)
+// for every i in [0, count) across the workers and the calling thread,
+// and returns when all calls have finished and every worker has checked
+// in for that loop, so none can still be holding on to it. One loop runs
+// at a time.
+class WorkerPool {
+  const size_t worker_count;
+  std::vector<std::thread> workers;
+  std::mutex run_mtx;
+
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::condition_variable done_cv;
+  const std::function<void(size_t)>* job = nullptr;
+  size_t count = 0;
+  uint64_t generation = 0;
+  size_t checked_in = 0;    // workers done with the current generation
+  bool stopping = false;
+  std::atomic<size_t> next {0};
+
+  void work(const std::function<void(size_t)>& f, size_t n) {
+    for (size_t i = next.fetch_add(1); i < n; i = next.fetch_add(1)) f(i);
+  }
+
+  void run_worker() {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock {mtx};
+    for (;;) {
+      cv.wait(lock, [&] { return stopping || generation != seen; });
+      if (stopping) return;
+      seen = generation;
+      const auto* f = job;
+      const size_t n = count;
+      lock.unlock();
+      work(*f, n);
+      lock.lock();
+      if (++checked_in == worker_count) done_cv.notify_all();
+    }
+  }
+
+public:
+  // threads counts the caller, so 1 runs everything inline
+  WorkerPool(size_t threads = std::thread::hardware_concurrency())
+    : worker_count(threads > 1 ? threads - 1 : 0) {
+    for (size_t i = 0; i < worker_count; ++i)
+      workers.emplace_back(&WorkerPool::run_worker, this);
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  ~WorkerPool() {
+    {
+      std::scoped_lock<std::mutex> lock {mtx};
+      stopping = true;
+    }
+    cv.notify_all();
+    for (auto& worker:workers) worker.join();
+  }
+
+  size_t size() const {
+    return worker_count + 1;
+  }
+
+  void run(size_t n, const std::function<void(size_t)>& f) {
+    std::scoped_lock<std::mutex> run_lock {run_mtx};
+    if (worker_count == 0 || n <= 1) {
+      for (size_t i = 0; i < n; ++i) f(i);
+      return;
+    }
+    {
+      std::scoped_lock<std::mutex> lock {mtx};
+      job = &f;
+      count = n;
+      next.store(0);
+      checked_in = 0;
+      ++generation;
+    }
+    cv.notify_all();
+    work(f, n);
+    // Every worker wakes for every generation; a late one finds no
+    // indices left, but f must outlive its check-in all the same
+    std::unique_lock<std::mutex> lock {mtx};
+    done_cv.wait(lock, [&] { return checked_in == worker_count; });
+    job = nullptr;
+  }
+};
@@ -1,22 +1,146 @@
 #include <iostream>
 #include <vector>
 #include <string>
-#include <sstream>
 #include <memory>
 #include <unordered_map>
+#include <functional>
+#include <stdexcept>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 
+// Fixed buffer in front of an fd or a callback. Text is handed on in
+// chunks only when the buffer fills up or on flush(), so memory stays
+// constant however large the document. A minified sink drops the
+// indentation and newlines between tags.
+class Sink {
+  vector<char> buffer;
+  size_t used = 0;
+  function<void(string_view)> out;
+  const bool minify;
+
+  static void write_fd(int fd, string_view chunk) {
+    while (!chunk.empty()) {
+      const ssize_t written = ::write(fd, chunk.data(), chunk.size());
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        throw runtime_error("write: "s + strerror(errno));
+      }
+      chunk.remove_prefix(written);
+    }
+  }
+
+public:
+  static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+
+  Sink(function<void(string_view)> out, bool minify = false,
+       size_t capacity = DEFAULT_CAPACITY)
+    : buffer(capacity), out(move(out)), minify(minify) {
+    if (capacity == 0)
+      throw invalid_argument("Sink capacity must not be zero");
+  }
+  Sink(int fd, bool minify = false, size_t capacity = DEFAULT_CAPACITY)
+    : Sink([fd](string_view chunk) { write_fd(fd, chunk); },
+           minify, capacity) {
+  }
+  Sink(const Sink&) = delete;
+  Sink& operator=(const Sink&) = delete;
+
+  // Call flush() first to see write errors; they are dropped here
+  ~Sink() {
+    try {
+      flush();
+    } catch (...) {
+    }
+  }
+
+  bool minified() const {
+    return minify;
+  }
+
+  void write(string_view text) {
+    if (text.size() > buffer.size() - used) {
+      flush();
+      if (text.size() >= buffer.size()) {
+        out(text);
+        return;
+      }
+    }
+    memcpy(buffer.data() + used, text.data(), text.size());
+    used += text.size();
+  }
+
+  void put(char ch) {
+    if (used == buffer.size()) flush();
+    buffer[used++] = ch;
+  }
+
+  void flush() {
+    if (used == 0) return;
+    const size_t n = used;
+    used = 0;
+    out(string_view(buffer.data(), n));
+  }
+};
+
+// Spaces for indentation, built at compile time
+struct IndentTable {
+  static constexpr size_t SIZE = 256;
+  char spaces[SIZE];
+
+  constexpr IndentTable()
+    : spaces() {
+    for (auto& ch:spaces) ch = ' ';
+  }
+};
+
 struct IHtmlTag {
   static constexpr auto INDENT_SIZE = 2u;
-  virtual ostream& gen(size_t level, ostream& o) const = 0;
+  // gen() and str() write into a stream or string that buffers anyway
+  static constexpr size_t STAGING_CAPACITY = 4096;
+  virtual ~IHtmlTag() = default;
+  virtual void render(size_t level, Sink& sink) const = 0;
+
+  // Streams the whole tree; nothing is buffered beyond the sink
+  void render(Sink& sink) const {
+    render(0, sink);
+    sink.flush();
+  }
+  ostream& gen(size_t level, ostream& o) const {
+    Sink sink([&o](string_view chunk) { o.write(chunk.data(), chunk.size()); },
+              false, STAGING_CAPACITY);
+    render(level, sink);
+    sink.flush();
+    return o;
+  }
   string str() const {
-    ostringstream oss;
-    gen(0, oss);
-    return oss.str();
+    string result;
+    Sink sink([&result](string_view chunk) { result.append(chunk); },
+              false, STAGING_CAPACITY);
+    render(0, sink);
+    sink.flush();
+    return result;
+  }
+
+protected:
+  static constexpr IndentTable INDENT_TABLE {};
+
+  static void render_indent(size_t level, Sink& sink) {
+    if (sink.minified()) return;
+    size_t n = level*INDENT_SIZE;
+    while (n > 0) {
+      const size_t chunk = min(n, IndentTable::SIZE);
+      sink.write(string_view(INDENT_TABLE.spaces, chunk));
+      n -= chunk;
+    }
   }
-  static string gen_indent(size_t level) {
-    return string(level*INDENT_SIZE, ' ');
+  static void render_newline(Sink& sink) {
+    if (!sink.minified()) sink.put('\n');
   }
 };
 
@@ -28,10 +152,10 @@ class PlainText final : public IHtmlTag {
   string text;
 
 protected:
-  virtual ostream& gen(size_t level, ostream& o) const {
-    const string indent = gen_indent(level);
-    o << indent << text << endl;
-    return o;
+  virtual void render(size_t level, Sink& sink) const override {
+    render_indent(level, sink);
+    sink.write(text);
+    render_newline(sink);
   }
 
   PlainText(string_view text)
@@ -51,17 +175,23 @@ protected:
   string name;
   AttributeMap attributes;
 
-  ostream& gen_open_tag(ostream& o) const {
-    o << "<" << name;
-    for (auto [key, value]:attributes)
-      o << " " << key << R"(=")" << value << R"(")";
-    o << ">";
-    return o;
+  void render_open_tag(Sink& sink) const {
+    sink.put('<');
+    sink.write(name);
+    for (auto& [key, value]:attributes) {
+      sink.put(' ');
+      sink.write(key);
+      sink.write(R"(=")");
+      sink.write(value);
+      sink.put('"');
+    }
+    sink.put('>');
   }
 
-  ostream& gen_close_tag(ostream& o) const {
-    o << "</" << name << ">";
-    return o;
+  void render_close_tag(Sink& sink) const {
+    sink.write("</");
+    sink.write(name);
+    sink.put('>');
   }
 
 public:
@@ -77,10 +207,8 @@ public:
 template <typename T>
 class SingularTag : public HtmlTag {
 protected:
-  virtual ostream& gen(size_t level, ostream& o) const {
-    const string indent = gen_indent(level);
-    o << indent; gen_open_tag(o); o << endl;
-    return o;
+  virtual void render(size_t level, Sink& sink) const override {
+    render_indent(level, sink); render_open_tag(sink); render_newline(sink);
   }
 
   SingularTag(string_view name = T::name)
@@ -110,13 +238,11 @@ class PairedTag : public HtmlTag {
   }
 
 protected:
-  virtual ostream& gen(size_t level, ostream& o) const {
-    const string indent = gen_indent(level);
-    o << indent; gen_open_tag(o); o << endl;
+  virtual void render(size_t level, Sink& sink) const override {
+    render_indent(level, sink); render_open_tag(sink); render_newline(sink);
     for (auto& child:children)
-      child->gen(level+1, o);
-    o << indent; gen_close_tag(o); o << endl;
-    return o;
+      child->render(level+1, sink);
+    render_indent(level, sink); render_close_tag(sink); render_newline(sink);
   }
 
   PairedTag(string_view name = T::name)
@@ -214,8 +340,8 @@ struct TagHrInternal {
 };
 using TagHr = SingularTag<TagHrInternal>;
 
-void test() {
-  IHtmlTagUPtr root =
+IHtmlTagUPtr make_document() {
+  return
     TagHtml::create({
       TagHead::create({
         TagTitle::create({
@@ -320,11 +446,61 @@ void test() {
        }) // A
       }) // body
     }, {{"lang", "en"}}); // html
+}
+
+void test() {
+  IHtmlTagUPtr root = make_document();
   cout << root->str() << endl;
+
+  Sink out(STDOUT_FILENO, true);
+  root->render(out);
+  out.write("\n");
+  out.flush();
+}
+
+// The document rendered rows times through str() and through sinks
+void test_stream(size_t rows) {
+  IHtmlTagUPtr root = make_document();
+
+  int fd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+  if (fd < 0)
+    throw runtime_error("Cannot open /dev/null");
+  using Clock = chrono::steady_clock;
+  auto begin = Clock::now();
+  size_t bytes = 0;
+  for (size_t i = 0; i < rows; ++i) {
+    const string text = root->str();
+    bytes += text.size();
+    if (::write(fd, text.data(), text.size()) < 0)
+      throw runtime_error("Cannot write /dev/null");
+  }
+  const chrono::duration<double, milli> copied = Clock::now() - begin;
+
+  begin = Clock::now();
+  {
+    Sink sink(fd);
+    for (size_t i = 0; i < rows; ++i) root->render(0, sink);
+    sink.flush();
+  }
+  const chrono::duration<double, milli> streamed = Clock::now() - begin;
+
+  begin = Clock::now();
+  {
+    Sink sink(fd, true);
+    for (size_t i = 0; i < rows; ++i) root->render(0, sink);
+    sink.flush();
+  }
+  const chrono::duration<double, milli> minified = Clock::now() - begin;
+  ::close(fd);
+
+  cerr << bytes / 1000000.0 << " MB: str() " << copied.count()
+       << " ms, render() " << streamed.count() << " ms, minified "
+       << minified.count() << " ms" << endl;
 }
 
 int main() {
   test();
+  test_stream(100000);
 
   return 0;
 }